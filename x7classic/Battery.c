@@ -0,0 +1,189 @@
+/*
+This file is part of mad-phenom.
+
+mad-phenom is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+mad-phenom is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with mad-phenom.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <avr/io.h>
+#include <avr/eeprom.h>
+#include <stdbool.h>
+#include "Battery.h"
+#include "Globals.h"
+
+battery_record battery;
+uint32_t battery_shotCharge = 0;
+
+// Survives power off, cleared from the menu when the battery is swapped
+battery_record EEMEM EEPROM_BATTERY;
+
+bool battery_loaded = false;
+uint32_t battery_lastMillis = 0;
+uint32_t battery_lastShot = 0;
+uint32_t battery_saved = 0;   // battery.used as of the last save
+
+// Next byte of the account to write out, one byte per pass
+uint8_t battery_pendingIndex = sizeof(battery_record);
+
+void battery_init() {
+	eeprom_read_block(&battery, &EEPROM_BATTERY, sizeof(battery_record));
+
+	// Erased EEPROM, nothing has been counted yet
+	if (battery.used == 0xFFFFFFFF) {
+		battery.used = 0;
+		battery.shots = 0;
+	}
+
+	battery_shotCharge = (uint32_t) BATTERY_SOLENOID_CURRENT * DWELL;
+	battery_saved = battery.used;
+	battery_lastMillis = 0;
+	battery_lastShot = 0;
+	battery_pendingIndex = sizeof(battery_record);
+	battery_loaded = true;
+}
+
+void addCharge(uint32_t charge) {
+	if (battery.used + charge >= battery.used) {
+		battery.used += charge;
+	}
+}
+
+#ifdef BATTERY_SENSE_CHANNEL
+/************************************************************************/
+/* Battery voltage in tenths of a volt.  Read just after the coil drops */
+/* out, while the battery is still sagging from it.                     */
+/************************************************************************/
+uint16_t battery_voltage() {
+	ADMUX = (1 << REFS1) | BATTERY_SENSE_CHANNEL;  // 1.1V reference
+	ADCSRA = (1 << ADEN) | (1 << ADSC) | (1 << ADPS2) | (1 << ADPS1);  // 125kHz ADC clock
+	while (ADCSRA & (1 << ADSC));
+
+	return (uint32_t) ADC * 11 * BATTERY_SENSE_DIVIDER / 1024;
+}
+#endif
+
+/************************************************************************/
+/* onTime - How long PA7 was high for this shot (ms)                    */
+/************************************************************************/
+void battery_shot(uint8_t onTime, uint32_t millisecond) {
+	uint32_t charge = (uint32_t) onTime * BATTERY_SOLENOID_CURRENT;
+
+#ifdef BATTERY_SENSE_CHANNEL
+	// The coil is resistive, its current follows the battery voltage
+	charge = charge * battery_voltage() / BATTERY_NOMINAL_VOLTAGE;
+#endif
+
+	if (charge > 0) {
+		battery_shotCharge = charge;
+	}
+	addCharge(charge);
+
+	if (battery.shots < 0xFFFF) {
+		battery.shots++;
+	}
+	battery_lastShot = millisecond;
+
+	// A save in progress starts over so it never mixes old and new bytes
+	if (battery_pendingIndex < sizeof(battery_record)) {
+		battery_pendingIndex = 0;
+		battery_saved = battery.used;
+	}
+}
+
+/************************************************************************/
+/* The account is written straight from battery, except for used which  */
+/* keeps running with the idle draw.  Its bytes come from battery_saved */
+/* so the record is the one from when the save started.                 */
+/************************************************************************/
+uint8_t pendingByte(uint8_t index) {
+	if (index < sizeof(battery.used)) {
+		return ((uint8_t *) &battery_saved)[index];
+	}
+	return ((uint8_t *) &battery)[index];
+}
+
+void battery_run(volatile uint32_t *millis) {
+	uint32_t now = (*millis);
+
+	// Loaded on the first pass rather than at boot, the idle draw since
+	// reset is still counted
+	if (!battery_loaded) {
+		battery_init();
+	}
+
+	// Idle draw, counted for every millisecond that passes
+	if (now != battery_lastMillis) {
+		addCharge((now - battery_lastMillis) * BATTERY_IDLE_CURRENT);
+		battery_lastMillis = now;
+	}
+
+	// A byte write takes 3.4ms, only start one when the last has finished
+	// so a save never holds up the run loop
+	if (battery_pendingIndex < sizeof(battery_record)) {
+		if (eeprom_is_ready()) {
+			eeprom_update_byte(((uint8_t *) &EEPROM_BATTERY) + battery_pendingIndex,
+				pendingByte(battery_pendingIndex));
+			battery_pendingIndex++;
+		}
+	} else if ((now - battery_lastShot) > BATTERY_SAVE_IDLE && (battery.used - battery_saved) >= BATTERY_SAVE_STEP) {
+		battery_pendingIndex = 0;
+		battery_saved = battery.used;
+	}
+}
+
+/************************************************************************/
+/* Writes the whole account now, used on power down                     */
+/************************************************************************/
+void battery_save() {
+	if (!battery_loaded) {
+		return;
+	}
+
+	battery_pendingIndex = sizeof(battery_record);
+	eeprom_update_block(&battery, &EEPROM_BATTERY, sizeof(battery_record));
+	battery_saved = battery.used;
+}
+
+/************************************************************************/
+/* A fresh battery has gone in                                          */
+/************************************************************************/
+void battery_reset() {
+	battery.used = 0;
+	battery.shots = 0;
+	battery_loaded = true;
+	battery_save();
+}
+
+uint32_t battery_remainingShots() {
+	if (battery.used >= BATTERY_CAPACITY_CHARGE) {
+		return 0;
+	}
+
+	return (BATTERY_CAPACITY_CHARGE - battery.used) / battery_shotCharge;
+}
+
+/************************************************************************/
+/* Red blinks for the shots remaining readout.  One blink means fewer   */
+/* than BATTERY_SHOTS_PER_BLINK are left.                               */
+/************************************************************************/
+uint8_t battery_blinks() {
+	uint32_t blinks = battery_remainingShots() / BATTERY_SHOTS_PER_BLINK + 1;
+
+	if (blinks > BATTERY_MAX_BLINKS) {
+		blinks = BATTERY_MAX_BLINKS;
+	}
+	return blinks;
+}
+
+bool battery_low() {
+	return battery_remainingShots() < BATTERY_LOW_SHOTS;
+}
@@ -0,0 +1,69 @@
+/*
+This file is part of mad-phenom.
+
+mad-phenom is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+mad-phenom is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with mad-phenom.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef BATTERY_H_
+#define BATTERY_H_
+
+#include <avr/io.h>
+#include <avr/eeprom.h>
+#include <stdbool.h>
+
+/************************************************************************/
+/* Battery account.  Charge is counted in mA x ms (microcoulombs): the  */
+/* coil's on-time from solenoid_run plus a fixed idle draw for every    */
+/* millisecond the marker is powered.  The defaults below are for a 9V  */
+/* alkaline and the stock coil, change them to suit the marker.         */
+/************************************************************************/
+
+#define BATTERY_CAPACITY 500           // mAh
+#define BATTERY_SOLENOID_CURRENT 1800  // mA while PA7 is high, at the nominal voltage
+#define BATTERY_IDLE_CURRENT 12        // mA for the board and LEDs
+#define BATTERY_NOMINAL_VOLTAGE 90     // Tenths of a volt
+
+// Define to correct the coil draw by the measured battery voltage.  The
+// battery goes through a divider of BATTERY_SENSE_DIVIDER:1 to this ADC
+// channel, measured against the 1.1V reference.
+//#define BATTERY_SENSE_CHANNEL 0
+#define BATTERY_SENSE_DIVIDER 11
+
+#define BATTERY_LOW_SHOTS 200          // Indicator turns red below this many shots
+#define BATTERY_SHOTS_PER_BLINK 1000   // Shots remaining readout, one red blink each
+#define BATTERY_MAX_BLINKS 10
+#define BATTERY_SAVE_IDLE 2000         // ms without a shot before the account is saved
+
+#define BATTERY_CAPACITY_CHARGE ((uint32_t) BATTERY_CAPACITY * 3600000UL)
+#define BATTERY_SAVE_STEP (BATTERY_CAPACITY_CHARGE / 100)
+
+typedef struct {
+	uint32_t used;   // Charge drawn from this battery
+	uint16_t shots;  // Shots fired on this battery (saturates)
+} battery_record;
+
+extern battery_record battery;
+extern uint32_t battery_shotCharge;   // Charge drawn by the last shot
+
+extern battery_record EEMEM EEPROM_BATTERY;
+
+void battery_init();
+void battery_run(volatile uint32_t *millis);
+void battery_shot(uint8_t onTime, uint32_t millisecond);
+void battery_save();
+void battery_reset();
+uint32_t battery_remainingShots();
+uint8_t battery_blinks();
+bool battery_low();
+
+#endif /* BATTERY_H_ */
@@ -0,0 +1,190 @@
+/*
+This file is part of mad-phenom.
+
+mad-phenom is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+mad-phenom is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with mad-phenom.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <avr/io.h>
+#include <avr/boot.h>
+#include <avr/pgmspace.h>
+#include <avr/wdt.h>
+#include <util/delay.h>
+#include "Bootloader.h"
+#include "Pins.h"
+
+/************************************************************************/
+/* Everything here is linked into .bootloader and must not call out to  */
+/* the application: an update may have half replaced it.  Hence the     */
+/* hand written CRC and direct pin access for the LEDs.                 */
+/************************************************************************/
+
+static uint16_t updateCrc(uint16_t crc, uint8_t data) BOOTLOADER_SECTION;
+static uint16_t updateCrc(uint16_t crc, uint8_t data) {
+	// CRC16-CCITT, polynomial 0x1021, MSB first
+	crc ^= (uint16_t) data << 8;
+	for (uint8_t i = 0; i < 8; i++) {
+		crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+	}
+	return crc;
+}
+
+static uint8_t receiveByte(uint16_t *crc) BOOTLOADER_SECTION;
+static uint8_t receiveByte(uint16_t *crc) {
+	// Idle is high, wait out the start bit's falling edge
+	while (PIN_IS_HIGH(BUTTON)) {
+		_delay_us(2);
+	}
+
+	// Sample each bit in its middle
+	_delay_us(BOOTLOADER_BIT_US / 2);
+	uint8_t data = 0;
+	for (uint8_t i = 0; i < 8; i++) {
+		_delay_us(BOOTLOADER_BIT_US);
+		data >>= 1;
+		if (PIN_IS_HIGH(BUTTON)) {
+			data |= 0x80;
+		}
+	}
+
+	// Into the stop bit, the next start bit can follow straight away
+	_delay_us(BOOTLOADER_BIT_US);
+	*crc = updateCrc(*crc, data);
+	return data;
+}
+
+static void writePage(uint16_t address, const uint8_t *data) BOOTLOADER_SECTION;
+static void writePage(uint16_t address, const uint8_t *data) {
+	// The CPU halts during erase and write on the ATtiny, so a frame
+	// arriving meanwhile is lost.  The uploader waits after each one.
+	boot_page_erase(address);
+	boot_spm_busy_wait();
+	for (uint8_t i = 0; i < SPM_PAGESIZE; i += 2) {
+		boot_page_fill(address + i, data[i] | ((uint16_t) data[i + 1] << 8));
+	}
+	boot_page_write(address);
+	boot_spm_busy_wait();
+}
+
+/************************************************************************/
+/* Receives one image and writes it.  Returns on the first bad frame so */
+/* the caller can report it, flash is left marked unfinished.           */
+/************************************************************************/
+uint8_t bootloader_update() {
+	uint8_t page[SPM_PAGESIZE];
+	uint8_t expected = 1;
+
+	for (;;) {
+		uint16_t crc = 0xFFFF;
+
+		// Anything else is line noise between frames
+		if (receiveByte(&crc) != FRAME_PAGE) {
+			continue;
+		}
+
+		uint8_t index = receiveByte(&crc);
+		for (uint8_t i = 0; i < SPM_PAGESIZE; i++) {
+			page[i] = receiveByte(&crc);
+		}
+
+		// Running the CRC on through its own big endian value leaves 0
+		receiveByte(&crc);
+		receiveByte(&crc);
+		if (crc != 0 || index != expected) {
+			return BOOTLOADER_BAD_FRAME;
+		}
+
+		if (index == 1) {
+			// From here on the old application is gone
+			boot_page_erase(BOOTLOADER_ENTRY_PAGE * SPM_PAGESIZE);
+			boot_spm_busy_wait();
+		}
+		writePage((uint16_t) index * SPM_PAGESIZE, page);
+		LED_GREEN_PIN = (1 << LED_GREEN_BIT);
+
+		if (index == BOOTLOADER_ENTRY_PAGE) {
+			return BOOTLOADER_OK;
+		}
+		expected++;
+	}
+}
+
+#ifdef __AVR__
+
+/************************************************************************/
+/* Replaces avr-libc's weak __init, the reset vector's target.  Nothing */
+/* of the C runtime has run yet: SP is at RAMEND from reset but r1 must */
+/* be cleared, and no global may be used.                               */
+/************************************************************************/
+void bootloader_reset() __asm__ ("__init") __attribute__ ((naked, used, section (".bootloader")));
+void bootloader_reset() {
+	__asm__ volatile ("clr __zero_reg__");
+
+	PIN_INPUT_PULLUP(BUTTON);
+	PIN_INPUT_PULLUP(TRIGGER_1);
+	_delay_us(20);
+
+	if ((PIN_CLOSED(BUTTON) && PIN_CLOSED(TRIGGER_1)) || !BOOTLOADER_APP_COMPLETE()) {
+		// A watchdog reset leaves the watchdog running
+		MCUSR &= ~(1 << WDRF);
+		wdt_disable();
+
+		PIN_OUTPUT(POWER);
+		PIN_HIGH(POWER);
+		PIN_OUTPUT(LED_RED);
+		PIN_OUTPUT(LED_GREEN);
+
+		// Red while listening, one blink after a bad frame
+		do {
+			PIN_LOW(LED_RED);
+			_delay_ms(250);
+			PIN_HIGH(LED_RED);
+		} while (bootloader_update() != BOOTLOADER_OK);
+		PIN_LOW(LED_RED);
+	}
+
+	// Hand the pins back as reset left them, the application sets its own
+	BUTTON_PORT &= ~(1 << BUTTON_BIT);
+	TRIGGER_1_PORT &= ~(1 << TRIGGER_1_BIT);
+	__asm__ volatile ("rjmp bootloader_appEntry");
+}
+
+/************************************************************************/
+/* Page 0, written once with a programmer.  Reset comes here through    */
+/* __init, every other vector goes on to its own slot in the            */
+/* application's table.                                                 */
+/************************************************************************/
+void bootloader_vectors() __attribute__ ((naked, used, section (".bootvectors")));
+void bootloader_vectors() {
+	__asm__ volatile (
+		"rjmp __init\n"
+		".rept %0\n"
+		"rjmp .+%1\n"
+		".endr"
+		:: "n" (_VECTORS_SIZE / 2 - 1), "n" (BOOTLOADER_APP_VECTORS));
+}
+
+/************************************************************************/
+/* Fixed at BOOTLOADER_APP_ENTRY in every image, so an old bootloader   */
+/* always finds the start of a new application's C runtime.             */
+/************************************************************************/
+void bootloader_appStart() __attribute__ ((naked, used, section (".init0")));
+void bootloader_appStart() {
+	// Empty, this only labels the start of .init0 where __init used to be
+}
+
+void bootloader_appEntry() __attribute__ ((naked, used, section (".appentry")));
+void bootloader_appEntry() {
+	__asm__ volatile ("rjmp bootloader_appStart");
+}
+
+#endif
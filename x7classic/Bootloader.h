@@ -0,0 +1,77 @@
+/*
+This file is part of mad-phenom.
+
+mad-phenom is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+mad-phenom is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with mad-phenom.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef BOOTLOADER_H_
+#define BOOTLOADER_H_
+
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <stdbool.h>
+
+/************************************************************************/
+/* Field bootloader.  It lives in the last 512 bytes of flash and owns  */
+/* page 0.  Holding the push button and trigger 1 at power on (or a     */
+/* reset after an update that never finished) keeps the marker in the   */
+/* bootloader, anything else jumps straight to the application.         */
+/*                                                                      */
+/* Images arrive one way over the push button line, active low 8N1 at   */
+/* BOOTLOADER_BAUD, sent by tools/fwupload.py, one frame per page:      */
+/*                                                                      */
+/*   FRAME_PAGE  index, SPM_PAGESIZE bytes, CRC16 (BE) of all before    */
+/*                                                                      */
+/* Pages 1 up to BOOTLOADER_ENTRY_PAGE are sent, in order.  Page 0 is   */
+/* never erased, so a power cut can not lose the reset vector: it holds */
+/* the vector table, written once with a programmer, and every          */
+/* interrupt goes on to the application's own table at                  */
+/* BOOTLOADER_APP_VECTORS.                                              */
+/*                                                                      */
+/* The entry page, the one under the bootloader, ends with the rjmp at  */
+/* BOOTLOADER_APP_ENTRY.  It is erased before page 1 is written and     */
+/* written last, so an erased entry is what marks an unfinished update  */
+/* and the entry page arriving in order is what completes one.          */
+/*                                                                      */
+/* Link with -Wl,--section-start=.bootvectors=0,                        */
+/* -Wl,--section-start=.text=0x40,                                      */
+/* -Wl,--section-start=.bootloader=0xe00 and                            */
+/* -Wl,--section-start=.appentry=0xdfe.                                 */
+/************************************************************************/
+
+#define BOOTLOADER_START 0x0E00   // Byte address, the last 512 bytes of flash
+#define BOOTLOADER_APP_ENTRY 0x0DFE // rjmp to the application's C runtime start up
+#define BOOTLOADER_APP_VECTORS 0x0040 // The application's vector table, page 1
+#define BOOTLOADER_PAGES (BOOTLOADER_START / SPM_PAGESIZE)
+#define BOOTLOADER_ENTRY_PAGE (BOOTLOADER_PAGES - 1)
+
+#define BOOTLOADER_BAUD 4800
+#define BOOTLOADER_BIT_US (1000000UL / BOOTLOADER_BAUD)
+
+#define FRAME_PAGE 0xA5
+
+// bootloader_update results
+#define BOOTLOADER_OK 0
+#define BOOTLOADER_BAD_FRAME 1  // CRC mismatch or page out of order
+
+// An update erases the application entry first and writes it last
+#define BOOTLOADER_APP_COMPLETE() (pgm_read_word_near(BOOTLOADER_APP_ENTRY) != 0xFFFF)
+
+// rjmp from one byte address to another, both within the 4K flash
+#define BOOTLOADER_RJMP(from, to) (0xC000 | ((((to) - (from)) / 2 - 1) & 0x0FFF))
+
+#define BOOTLOADER_SECTION __attribute__ ((section (".bootloader")))
+
+uint8_t bootloader_update() BOOTLOADER_SECTION;
+
+#endif /* BOOTLOADER_H_ */
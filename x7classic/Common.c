@@ -18,11 +18,13 @@ along with mad-phenom.  If not, see <http://www.gnu.org/licenses/>.
 #include <avr/interrupt.h>
 #include <avr/eeprom.h>
 #include <stdbool.h>
-#define F_CPU 8000000UL
 #include <util/delay.h>
 #include "Common.h"
 #include "Globals.h"
 #include "Trigger.h"
+#include "Pins.h"
+#include "Program.h"
+#include "Trainer.h"
 
 /************************************************************************/
 /*  COMMON ROUTINES                                                     */
@@ -34,13 +36,42 @@ void delay_ms(uint16_t ms){
 	}
 }
 
-void loadPreset() {
-	BALLS_PER_SECOND = eeprom_read_byte(&EEPROM_BALLS_PER_SECOND[currentSelector][CURRENT_PRESET[currentSelector]]);
-	FIRING_MODE = eeprom_read_byte(&EEPROM_FIRING_MODE[currentSelector][CURRENT_PRESET[currentSelector]]);
-	BURST_SIZE = eeprom_read_byte(&EEPROM_BURST_SIZE[currentSelector][CURRENT_PRESET[currentSelector]]);
-	AMMO_LIMIT = eeprom_read_byte(&EEPROM_AMMO_LIMIT[currentSelector][CURRENT_PRESET[currentSelector]]);
-	SAFETY_SHOT = eeprom_read_byte(&EEPROM_SAFETY_SHOT[currentSelector][CURRENT_PRESET[currentSelector]]);
-	
+preset_settings stagedPreset;
+bool presetStaged = false;
+
+/************************************************************************/
+/* Where the current preset sits in the [2][MAX_PRESETS] EEPROM         */
+/* settings, counted from the first row                                 */
+/************************************************************************/
+uint8_t presetSlot() {
+	return currentSelector * MAX_PRESETS + CURRENT_PRESET[currentSelector];
+}
+
+/************************************************************************/
+/* Reads the current preset from EEPROM without touching the live       */
+/* settings.  applyPreset() swaps them in.                              */
+/************************************************************************/
+void stagePreset() {
+	uint8_t slot = presetSlot();
+
+	stagedPreset.ballsPerSecond = eeprom_read_byte(EEPROM_BALLS_PER_SECOND[0] + slot);
+	stagedPreset.firingMode = eeprom_read_byte(EEPROM_FIRING_MODE[0] + slot);
+	stagedPreset.burstSize = eeprom_read_byte(EEPROM_BURST_SIZE[0] + slot);
+	stagedPreset.ammoLimit = eeprom_read_byte(EEPROM_AMMO_LIMIT[0] + slot);
+	stagedPreset.safetyShot = eeprom_read_byte(EEPROM_SAFETY_SHOT[0] + slot);
+	stagedPreset.bufferDepth = eeprom_read_byte(EEPROM_BUFFER_DEPTH[0] + slot);
+	presetStaged = true;
+}
+
+void applyPreset() {
+	BALLS_PER_SECOND = stagedPreset.ballsPerSecond;
+	FIRING_MODE = stagedPreset.firingMode;
+	BURST_SIZE = stagedPreset.burstSize;
+	AMMO_LIMIT = stagedPreset.ammoLimit;
+	SAFETY_SHOT = stagedPreset.safetyShot;
+	BUFFER_DEPTH = stagedPreset.bufferDepth;
+	presetStaged = false;
+
 	// If the data is invalid, use default values
 	if (BALLS_PER_SECOND < 5 || BALLS_PER_SECOND > 40) {
 		BALLS_PER_SECOND = 20;
@@ -59,56 +90,42 @@ void loadPreset() {
 		SAFETY_SHOT = 0;
 	}
 	
-	DWELL = 8;
+	// Default to two shots buffered
+	if (BUFFER_DEPTH > MAX_BUFFER_DEPTH) {
+		BUFFER_DEPTH = 2;
+	}
 	
-	// Cutting this in down since I think the tippmann default is for trigger pull and release.
-	RELEASE_DEBOUNCE = 20; //Tippmann default - 52;
-	ROUND_DELAY = (1000 - DWELL) / BALLS_PER_SECOND;
+	ROUND_DELAY = (1000U - DWELL) / BALLS_PER_SECOND;
 	
 	// Default to full auto
 	// 0 = full auto
 	// 1 = three round burst
 	// 2 = Auto Response
 	// 3 = Semi-Auto (single shot)
-	if (FIRING_MODE < 0 || FIRING_MODE > 3) {
+	// 4 = Custom program from EEPROM
+	// 5 = Pull speed trainer, never fires
+	if (FIRING_MODE < 0 || FIRING_MODE > MODE_TRAINER) {
 		FIRING_MODE = 0;
 	}
 
+	program_load();
+}
+
+void loadPreset() {
+	stagePreset();
+	applyPreset();
+
 	// Activate the new FIRING_MODE
 	//trigger_changeMode();
 	trigger_pulled = false;
 }
 
 void initialize() {
-	EEPROM_BALLS_PER_SECOND[0][0] = EEPROM_BALLS_PER_SECOND_1;
-	EEPROM_FIRING_MODE[0][0] = EEPROM_FIRING_MODE_1;
-	EEPROM_BURST_SIZE[0][0] = EEPROM_BURST_SIZE_1;
-	EEPROM_AMMO_LIMIT[0][0] = EEPROM_AMMO_LIMIT_1;
-
-	EEPROM_BALLS_PER_SECOND[0][1] = EEPROM_BALLS_PER_SECOND_2;
-	EEPROM_FIRING_MODE[0][1] = EEPROM_FIRING_MODE_2;
-	EEPROM_BURST_SIZE[0][1] = EEPROM_BURST_SIZE_2;
-	EEPROM_AMMO_LIMIT[0][1] = EEPROM_AMMO_LIMIT_2;
-
-	EEPROM_BALLS_PER_SECOND[0][2] = EEPROM_BALLS_PER_SECOND_3;
-	EEPROM_FIRING_MODE[0][2] = EEPROM_FIRING_MODE_3;
-	EEPROM_BURST_SIZE[0][2] = EEPROM_BURST_SIZE_3;
-	EEPROM_AMMO_LIMIT[0][2] = EEPROM_AMMO_LIMIT_3;
-
-	EEPROM_BALLS_PER_SECOND[1][0] = EEPROM_BALLS_PER_SECOND_1;
-	EEPROM_FIRING_MODE[1][0] = EEPROM_FIRING_MODE_1;
-	EEPROM_BURST_SIZE[1][0] = EEPROM_BURST_SIZE_1;
-	EEPROM_AMMO_LIMIT[1][0] = EEPROM_AMMO_LIMIT_1;
-
-	EEPROM_BALLS_PER_SECOND[1][1] = EEPROM_BALLS_PER_SECOND_2;
-	EEPROM_FIRING_MODE[1][1] = EEPROM_FIRING_MODE_2;
-	EEPROM_BURST_SIZE[1][1] = EEPROM_BURST_SIZE_2;
-	EEPROM_AMMO_LIMIT[1][1] = EEPROM_AMMO_LIMIT_2;
-
-	EEPROM_BALLS_PER_SECOND[1][2] = EEPROM_BALLS_PER_SECOND_3;
-	EEPROM_FIRING_MODE[1][2] = EEPROM_FIRING_MODE_3;
-	EEPROM_BURST_SIZE[1][2] = EEPROM_BURST_SIZE_3;
-	EEPROM_AMMO_LIMIT[1][2] = EEPROM_AMMO_LIMIT_3;
+	// Not part of a preset, a preset swap leaves them alone
+	DWELL = 8;
+
+	// Cutting this in down since I think the tippmann default is for trigger pull and release.
+	RELEASE_DEBOUNCE = 20; //Tippmann default - 52;
 
 	CURRENT_PRESET[0] = eeprom_read_byte(&EEPROM_PRESET_1);
 	if (CURRENT_PRESET[0] < 0 || CURRENT_PRESET[0] > (MAX_PRESETS - 1)) {
@@ -120,6 +137,9 @@ void initialize() {
 		CURRENT_PRESET[1] = 0;
 	}
 
+	// Start on the preset the selector is already on
+	currentSelector = PIN_CLOSED(SELECTOR) ? 1 : 0;
+
 	loadPreset();
 }
 
@@ -136,23 +156,24 @@ void togglePreset(){
 		eeprom_write_byte(&EEPROM_PRESET_2, CURRENT_PRESET[1]);
 	}
 	
-	loadPreset();
+	// Takes effect at the next shot boundary
+	stagePreset();
 }
 
 void redOff() {
-	PORTA &= ~(1 << PINA1); // RED
+	PIN_LOW(LED_RED);
 }
 
 void greenOff() {
-	PORTA &= ~(1 << PINA2); // GREEN
+	PIN_LOW(LED_GREEN);
 }
 
 void redOn() {
-	PORTA |= (1 << PINA1); // RED
+	PIN_HIGH(LED_RED);
 }
 
 void greenOn() {
-	PORTA |= (1 << PINA2); // RED
+	PIN_HIGH(LED_GREEN);
 }
 
 void redSet(bool state) {
@@ -172,13 +193,13 @@ void greenSet(bool state) {
 }
 
 void solenoidOn() {
-	PORTA |= (1 << PINA7);
+	PIN_HIGH(SOLENOID);
 }
 
 void solenoidOff() {
-	PORTA &= ~(1 << PINA7);
+	PIN_LOW(SOLENOID);
 }
 
 bool pushButtonHasInput() {
-	return (PINB & (1 << PINB1)) <= 0;
+	return PIN_CLOSED(BUTTON);
 }
\ No newline at end of file
@@ -23,7 +23,25 @@ along with mad-phenom.  If not, see <http://www.gnu.org/licenses/>.
 #define HIGH 1
 #define LOW 0
 
+/************************************************************************/
+/* A preset read from EEPROM, waiting to replace the live settings      */
+/************************************************************************/
+typedef struct {
+	uint8_t ballsPerSecond;
+	uint8_t firingMode;
+	uint8_t burstSize;
+	uint8_t ammoLimit;
+	uint8_t safetyShot;
+	uint8_t bufferDepth;
+} preset_settings;
+
+extern preset_settings stagedPreset;
+extern bool presetStaged;
+
+uint8_t presetSlot();
 void loadPreset();
+void stagePreset();
+void applyPreset();
 void delay_ms(uint16_t ms);
 void initialize();
 void togglePreset();
@@ -21,67 +21,32 @@ along with mad-phenom.  If not, see <http://www.gnu.org/licenses/>.
 
 #define MAX_PRESETS 3
 
-#define TRIGGER_PIN_1 5
-#define TRIGGER_PIN_2 7
-#define PIN_LED_GREEN 11
-#define PIN_LED_RED 12
-#define PIN_LED_YELLOW 6
-#define PIN_SOLENOID 6
-#define PIN_PUSHBUTTON 3
-
 #define PULL_DEBOUNCE 20
+#define SWITCH_DEBOUNCE 2 // Lockout after an edge on one trigger switch (ms)
+#define SWITCH_STUCK_TIME 500 // How long the two trigger switches may disagree (ms)
+#define SELECTOR_DEBOUNCE 30 // How long the selector has to settle (ms)
+#define SHOT_EXPIRY 200 // Buffered shots older than this are dropped (ms)
+#define MAX_BUFFER_DEPTH 4
+#define CONFIG_HOLD_TIME 1000 // Button held from power on to enter config mode (ms)
 
 extern uint8_t CURRENT_PRESET[2];
 extern uint8_t EEMEM EEPROM_PRESET_1;
 extern uint8_t EEMEM EEPROM_PRESET_2;
 
-extern uint8_t EEMEM EEPROM_BALLS_PER_SECOND_1;
-extern uint8_t EEMEM EEPROM_FIRING_MODE_1;
-extern uint8_t EEMEM EEPROM_BURST_SIZE_1;
-extern uint8_t EEMEM EEPROM_AMMO_LIMIT_1;
-extern uint8_t EEMEM EEPROM_SAFETY_SHOT_1;
-
-extern uint8_t EEMEM EEPROM_BALLS_PER_SECOND_2;
-extern uint8_t EEMEM EEPROM_FIRING_MODE_2;
-extern uint8_t EEMEM EEPROM_BURST_SIZE_2;
-extern uint8_t EEMEM EEPROM_AMMO_LIMIT_2;
-extern uint8_t EEMEM EEPROM_SAFETY_SHOT_2;
-
-extern uint8_t EEMEM EEPROM_BALLS_PER_SECOND_3;
-extern uint8_t EEMEM EEPROM_FIRING_MODE_3;
-extern uint8_t EEMEM EEPROM_BURST_SIZE_3;
-extern uint8_t EEMEM EEPROM_AMMO_LIMIT_3;
-extern uint8_t EEMEM EEPROM_SAFETY_SHOT_3;
-
-extern uint8_t EEMEM EEPROM_BALLS_PER_SECOND_4;
-extern uint8_t EEMEM EEPROM_FIRING_MODE_4;
-extern uint8_t EEMEM EEPROM_BURST_SIZE_4;
-extern uint8_t EEMEM EEPROM_AMMO_LIMIT_4;
-extern uint8_t EEMEM EEPROM_SAFETY_SHOT_4;
-
-extern uint8_t EEMEM EEPROM_BALLS_PER_SECOND_5;
-extern uint8_t EEMEM EEPROM_FIRING_MODE_5;
-extern uint8_t EEMEM EEPROM_BURST_SIZE_5;
-extern uint8_t EEMEM EEPROM_AMMO_LIMIT_5;
-extern uint8_t EEMEM EEPROM_SAFETY_SHOT_5;
-
-extern uint8_t EEMEM EEPROM_BALLS_PER_SECOND_6;
-extern uint8_t EEMEM EEPROM_FIRING_MODE_6;
-extern uint8_t EEMEM EEPROM_BURST_SIZE_6;
-extern uint8_t EEMEM EEPROM_AMMO_LIMIT_6;
-extern uint8_t EEMEM EEPROM_SAFETY_SHOT_6;
-
-extern uint8_t EEPROM_BALLS_PER_SECOND[2][MAX_PRESETS];
-extern uint8_t EEPROM_FIRING_MODE[2][MAX_PRESETS];
-extern uint8_t EEPROM_BURST_SIZE[2][MAX_PRESETS];
-extern uint8_t EEPROM_AMMO_LIMIT[2][MAX_PRESETS];
-extern uint8_t EEPROM_SAFETY_SHOT[2][MAX_PRESETS];
+// Per preset settings [selector][preset], read when a preset is staged
+extern uint8_t EEMEM EEPROM_BALLS_PER_SECOND[2][MAX_PRESETS];
+extern uint8_t EEMEM EEPROM_FIRING_MODE[2][MAX_PRESETS];
+extern uint8_t EEMEM EEPROM_BURST_SIZE[2][MAX_PRESETS];
+extern uint8_t EEMEM EEPROM_AMMO_LIMIT[2][MAX_PRESETS];
+extern uint8_t EEMEM EEPROM_SAFETY_SHOT[2][MAX_PRESETS];
+extern uint8_t EEMEM EEPROM_BUFFER_DEPTH[2][MAX_PRESETS];
 
 extern uint8_t BALLS_PER_SECOND;
 extern uint8_t FIRING_MODE;
 extern uint8_t BURST_SIZE;
 extern uint8_t AMMO_LIMIT;
 extern uint8_t SAFETY_SHOT;
+extern uint8_t BUFFER_DEPTH; // Shots that may wait behind the one held by the rate cap
 
 extern uint8_t ROUND_DELAY; // delay between shots in ms
 extern uint8_t RELEASE_DEBOUNCE;  // Debounce in ms
@@ -18,6 +18,12 @@ along with mad-phenom.  If not, see <http://www.gnu.org/licenses/>.
 #include "Globals.h"
 #include "Common.h"
 #include "Menu.h"
+#include "Pins.h"
+#include "Stack.h"
+#include "Program.h"
+#include "Battery.h"
+#include "Trainer.h"
+#include "Trigger.h"
 
 /************************************************************************/
 /* CONFIG MENU                                                          */
@@ -30,10 +36,27 @@ along with mad-phenom.  If not, see <http://www.gnu.org/licenses/>.
 		1 - Three Round Burst
 		2 - Auto Response
 		3 - Semi-Auto (Single Shot)
+		4 - Custom program (EEPROM)
+		5 - Pull speed trainer (never fires)
 	1 - Firing Rate (Ball Per Second)
 		5 - 40
 	2 - Burst size
 		2 - 10
+	3 - Ammo limit
+		0 - 250
+	4 - Safety shot
+		0 - 5
+	5 - Shot buffer depth (Auto Response)
+		0 - 4
+	6 - New battery (clears the battery account)
+	7 - Switch health (reads out the trigger switch wear counters)
+
+	Numbers are read out and entered a digit at a time: hundreds blink
+	orange, tens red and ones green, a long blink is a zero.  The current
+	value is read out first, then each digit blinks on its own and the
+	trigger steps it, starting from the current digit.  Holding the
+	trigger keeps the digit and moves to the next.  The value stored is
+	read back before the success blink.
 
 */
 #define NOT_SELECTED 255
@@ -41,11 +64,24 @@ volatile uint8_t currentMenu = 0;
 volatile uint8_t menuMax = 0;
 volatile uint8_t selectedMenu = NOT_SELECTED;
 
+#define PLACE_HUNDREDS 0
+#define PLACE_TENS 1
+#define PLACE_ONES 2
+
+#define DIGIT_ON 150   // ms per blink of a digit
+#define DIGIT_OFF 250
+#define DIGIT_ZERO 600 // ms of the single blink for a zero
+#define DIGIT_GAP 600  // ms between places of a readout
+#define DIGIT_REPEAT 1200 // ms before a digit being entered is shown again
+
+static const uint8_t placeUnits[] = {100, 10, 1};
+
 void getNumberFromUser(uint8_t currentNumber, uint8_t max);
+void showNumber(uint8_t number);
 
 void lightsOff() {
-	PORTA &= ~(1 << PINA2); // GREEN
-	PORTA &= ~(1 << PINA1); // RED
+	PIN_LOW(LED_GREEN);
+	PIN_LOW(LED_RED);
 }
 
 /************************************************************************/
@@ -64,121 +100,116 @@ void orangeLed() {
 }
 
 /************************************************************************/
-/* This is used for the X7 classic to distinguish between F and FA      */
+/* Shows choice n as n + 1 blinks, red or orange, and returns the one   */
+/* selected                                                             */
 /************************************************************************/
-
-
-void presetMenu() {
-
-	// SELECTOR
-	currentSelector = 0;
-	menuMax = 1;
+uint8_t blinkMenu(uint8_t max, bool orange) {
+	menuMax = max;
 	selectedMenu = NOT_SELECTED;
 	currentMenu = 0;
 
 	while(selectedMenu == NOT_SELECTED) {
-		if (currentMenu == 0) { // Preset 1
-			redOn();
-			delay_ms(100);
-			redOff();
-			delay_ms(800);
-		} else if (currentMenu == 1) { // Preset 2
-			for (uint8_t i = 0; i < 2; i++) {
+		uint8_t shown = currentMenu;
+
+		for (uint8_t i = 0; i <= shown; i++) {
+			if (orange) {
+				orangeLed();
+			} else {
 				redOn();
 				delay_ms(100);
 				redOff();
-				delay_ms(100);
 			}
-
-			delay_ms(700);
+			delay_ms(100);
 		}
+
+		// Two or more orange blinks get a longer pause
+		delay_ms((orange && shown > 0) ? 800 : 700);
 	}
 
-	currentSelector = selectedMenu;
+	return selectedMenu;
+}
+
+/************************************************************************/
+/* Blinks red or green count times then pauses for a second, a          */
+/* selection cuts the pause short                                       */
+/************************************************************************/
+void blinkCount(uint8_t count, bool red) {
+	lightsOff();
 
-	////////
+	for (uint8_t i = 0; i < count; i++) {
+		redSet(red);
+		greenSet(!red);
+		delay_ms(100);
+		lightsOff();
+		delay_ms(100);
+	}
 
-	menuMax = 2;
-	selectedMenu = NOT_SELECTED;
-	currentMenu = 0;
-	while(selectedMenu == NOT_SELECTED) {
-				
-		if (currentMenu == 0) { // Preset 1
-			orangeLed();
-			delay_ms(800);
-		} else if (currentMenu == 1) { // Preset 2
-			for (uint8_t i = 0; i < 2; i++) {
-				orangeLed();
-				delay_ms(100);
-			}
-			
-			delay_ms(800);
-		} else if (currentMenu == 2) {  // Preset 3
-			for (uint8_t i = 0; i < 3; i++) {
-				orangeLed();
-				delay_ms(100);
-			}
-			
-			delay_ms(800);
+	for (uint8_t i = 0; i < 90; i++) {
+		if (selectedMenu != NOT_SELECTED) {
+			return;
 		}
+		delay_ms(10);
 	}
-	
-	CURRENT_PRESET[currentSelector] = selectedMenu;
+}
+
+/************************************************************************/
+/* This is used for the X7 classic to distinguish between F and FA      */
+/************************************************************************/
+
+
+void presetMenu() {
+	// SELECTOR, one or two red blinks
+	currentSelector = blinkMenu(1, false);
+
+	// Preset, one to three orange blinks
+	CURRENT_PRESET[currentSelector] = blinkMenu(2, true);
 }
 
 void mainMenu() {
-	menuMax = 4;
+	menuMax = 7;
 	selectedMenu = NOT_SELECTED;
 	currentMenu = 0;
 	bool state = false;
 	while(selectedMenu == NOT_SELECTED) {
+		state = !state;
+
 		if (currentMenu == 0) { // Firing Mode (toggle green then red)
-			state = !state;
-			
 			redSet(!state);
 			greenSet(state);
 						
 			delay_ms(100);
 		} else if (currentMenu == 1) { // Firing Rate (fast green blink)
-			state = !state;
-			
 			redOff();
 			greenSet(state);
 			
 			delay_ms(50);
 		} else if (currentMenu == 2) {  // Burst size (three red blinks)
-			lightsOff();
-			
-			// Display as three blinks of red then pause and repeat
-			for (uint8_t i = 0; i < 3; i++) {
-				redOn();
-				delay_ms(100);
-				redOff();
-				
-				if (i == 2) {
-					for (uint8_t i = 0; i < 100; i++) {
-						delay_ms(10);
-						
-						if (selectedMenu != NOT_SELECTED) {
-							break;
-						}
-					}					
-				} else {
-					delay_ms(100);
-				}
-			}
+			blinkCount(3, true);
 		} else if (currentMenu == 3) {  // Ammo Limit (Solid Red)
 			redOn();
 			greenOff();
 		} else if (currentMenu == 4) {  // Safety Shot (Solid Green)
 			redOff();
 			greenOn();
-		}			
+		} else if (currentMenu == 5) {  // Buffer depth (Orange blink)
+			lightsOff();
+			orangeLed();
+			delay_ms(100);
+		} else if (currentMenu == 6) {  // New battery (fast red blink)
+			greenOff();
+			redSet(state);
+			
+			delay_ms(50);
+		} else if (currentMenu == 7) {  // Switch health (slow orange blink)
+			lightsOff();
+			orangeLed();
+			delay_ms(900);
+		}
 	}
 }
 
 void firingModeMenu() {
-	menuMax = 3;
+	menuMax = MODE_TRAINER;
 	selectedMenu = NOT_SELECTED;
 	currentMenu = FIRING_MODE;
 	bool state = LOW;
@@ -190,25 +221,8 @@ void firingModeMenu() {
 			greenOff();
 			
 			delay_ms(50);
-		} else if (currentMenu == 1) { // Three Round Burst
-			lightsOff();
-			
-			// Display as three blinks of green then pause and repeat
-			for (uint8_t i = 0; i < 3; i++) {
-				greenOn();
-				delay_ms(100);
-				greenOff();
-				
-				if (selectedMenu != NOT_SELECTED) {
-					break;
-				}
-				
-				if (i == 2) {
-					delay_ms(1000);
-				} else {
-					delay_ms(100);
-				}
-			}				
+		} else if (currentMenu == 1) { // Three Round Burst (three green blinks)
+			blinkCount(3, false);
 		} else if (currentMenu == 2) { // Auto Response
 			lightsOff();
 	
@@ -229,38 +243,49 @@ void firingModeMenu() {
 		} else if (currentMenu == 3) { // Auto Response
 			redOff();
 			greenOn();
+		} else if (currentMenu == MODE_CUSTOM) { // Custom program (solid orange)
+			orangeLed();
+		} else if (currentMenu == MODE_TRAINER) { // Trainer (slow orange blink)
+			lightsOff();
+			orangeLed();
+			delay_ms(400);
 		}
 	}
 	
-	if (selectedMenu >= 0 && selectedMenu <= 3) {
-		eeprom_write_byte(&EEPROM_FIRING_MODE[currentSelector][CURRENT_PRESET[currentSelector]], selectedMenu);
+	if (selectedMenu >= 0 && selectedMenu <= MODE_TRAINER) {
+		eeprom_write_byte(EEPROM_FIRING_MODE[0] + presetSlot(), selectedMenu);
 		successBlink();
 	} else {
 		failureBlink();
 	}
 }
 
-void ammoLimitMenu() {
-	getNumberFromUser(AMMO_LIMIT, 250);
-	
-	// Burst size was entered into selectedMenu.  Verify it and save it.
-	if (selectedMenu >= 0 && selectedMenu <= 250) {
-		eeprom_write_byte(&EEPROM_AMMO_LIMIT[currentSelector][CURRENT_PRESET[currentSelector]], selectedMenu);
-		AMMO_LIMIT = selectedMenu;
-		successBlink();
-	} else {
-		failureBlink();
-	}
+/************************************************************************/
+/* Stores the number entered and reads the stored value back to the     */
+/* user before the success blink                                        */
+/************************************************************************/
+uint8_t saveNumber(uint8_t *address) {
+	eeprom_write_byte(address, selectedMenu);
+	uint8_t stored = eeprom_read_byte(address);
+
+	delay_ms(500);
+	showNumber(stored);
+	delay_ms(DIGIT_GAP);
+	successBlink();
+
+	return stored;
 }
 
-void safetyShotMenu() {
-	getNumberFromUser(SAFETY_SHOT, 5);
-	
-	// Burst size was entered into selectedMenu.  Verify it and save it.
-	if (selectedMenu >= 0 && selectedMenu <= 250) {
-		eeprom_write_byte(&EEPROM_SAFETY_SHOT[currentSelector][CURRENT_PRESET[currentSelector]], selectedMenu);
-		SAFETY_SHOT = selectedMenu;
-		successBlink();
+/************************************************************************/
+/* Has the user enter a new value for one of the preset's numeric       */
+/* settings.  eeprom is the first row of its [2][MAX_PRESETS] array.    */
+/************************************************************************/
+void numberMenu(uint8_t *setting, uint8_t *eeprom, uint8_t min, uint8_t max) {
+	getNumberFromUser(*setting, max);
+
+	// The number was entered into selectedMenu.  Verify it and save it.
+	if (selectedMenu >= min && selectedMenu <= max) {
+		*setting = saveNumber(eeprom + presetSlot());
 	} else {
 		failureBlink();
 	}
@@ -289,60 +314,131 @@ void failureBlink() {
 	}
 }
 
-void rateOfFireMenu() {
-	 getNumberFromUser(BALLS_PER_SECOND, 40);
-	
-	// Firing rate was entered into selectedMenu.  Verify it and save it.
-	if (selectedMenu >= 5 && selectedMenu <= 40) {
-		eeprom_write_byte(&EEPROM_BALLS_PER_SECOND[currentSelector][CURRENT_PRESET[currentSelector]], selectedMenu);
-		BALLS_PER_SECOND = selectedMenu;
-		successBlink();
+/************************************************************************/
+/* One blink of a place's colour, orange for the hundreds               */
+/************************************************************************/
+void placeBlink(uint8_t place, uint16_t ms) {
+	if (place == PLACE_HUNDREDS) {
+		for (uint16_t i = 0; i < ms / 3; i++) {
+			greenOn();
+			delay_ms(2);
+			redOn();
+			greenOff();
+			delay_ms(1);
+			redOff();
+		}
 	} else {
-		failureBlink();
+		if (place == PLACE_TENS) {
+			redOn();
+		} else {
+			greenOn();
+		}
+		delay_ms(ms);
+		lightsOff();
 	}
 }
 
-void burstSizeMenu() {
-	getNumberFromUser(BURST_SIZE, 10);
-	
-	// Burst size was entered into selectedMenu.  Verify it and save it.
-	if (selectedMenu >= 2 && selectedMenu <= 10) {
-		eeprom_write_byte(&EEPROM_BURST_SIZE[currentSelector][CURRENT_PRESET[currentSelector]], selectedMenu);
-		BURST_SIZE = selectedMenu;
-		successBlink();
-	} else {
-		failureBlink();
+/************************************************************************/
+/* Blinks one digit.  While entering, a tap or hold cuts it short.      */
+/************************************************************************/
+void showDigit(uint8_t place, uint8_t digit, bool entering) {
+	uint8_t shown = currentMenu;
+
+	if (digit == 0) {
+		placeBlink(place, DIGIT_ZERO);
+		delay_ms(DIGIT_OFF);
+		return;
+	}
+
+	for (uint8_t i = 0; i < digit; i++) {
+		placeBlink(place, DIGIT_ON);
+		delay_ms(DIGIT_OFF);
+
+		if (entering && (selectedMenu != NOT_SELECTED || currentMenu != shown)) {
+			return;
+		}
 	}
 }
 
+void showNumber(uint8_t number) {
+	lightsOff();
+
+	for (uint8_t place = PLACE_HUNDREDS; place <= PLACE_ONES; place++) {
+		// Leading zeros are left out, zero itself still shows its ones
+		if (number < placeUnits[place] && place != PLACE_ONES) {
+			continue;
+		}
+
+		showDigit(place, number / placeUnits[place] % 10, false);
+		delay_ms(DIGIT_GAP);
+	}
+}
+
+/************************************************************************/
+/* Reads out currentNumber, then has the user enter each digit of the   */
+/* new one.  The number entered is left in selectedMenu.                */
+/************************************************************************/
 void getNumberFromUser(uint8_t currentNumber, uint8_t max) {
-	bool state = false;
-	menuMax = max;
-	selectedMenu = NOT_SELECTED;
-	currentMenu = 0;
-	uint8_t currentRate = currentNumber;
-	uint8_t displayRate = 0;
+	uint8_t number = 0;
+	uint8_t place = (max >= 100) ? PLACE_HUNDREDS : (max >= 10) ? PLACE_TENS : PLACE_ONES;
+
 	delay_ms(500);
-	while(selectedMenu == NOT_SELECTED) {
-		if (currentMenu == 0) {
-			if (state) {
-				displayRate++;
-			}
-			
-			state = !state;
-			
-			redOff();
-			greenSet(state);
-			
-			delay_ms(200);
-			
-			if (displayRate >= currentRate) {
-				displayRate = 0;
-				delay_ms(1000);
+	showNumber(currentNumber);
+	delay_ms(DIGIT_GAP);
+
+	for (; place <= PLACE_ONES; place++) {
+		uint8_t unit = placeUnits[place];
+		uint8_t limit = (uint8_t)(max - number) / unit;
+		if (limit > 9) {
+			limit = 9;
+		}
+
+		// Taps during the readout don't count
+		menuMax = limit;
+		currentMenu = currentNumber / unit % 10;
+		if (currentMenu > limit) {
+			currentMenu = limit;
+		}
+		selectedMenu = NOT_SELECTED;
+
+		while (selectedMenu == NOT_SELECTED) {
+			uint8_t shown = currentMenu;
+			showDigit(place, shown, true);
+
+			for (uint8_t i = 0; i < DIGIT_REPEAT / 10; i++) {
+				if (selectedMenu != NOT_SELECTED || currentMenu != shown) {
+					break;
+				}
+				delay_ms(10);
 			}
-		} else {
-			lightsOff();
 		}
+
+		number += selectedMenu * unit;
+	}
+
+	selectedMenu = number;
+}
+
+/************************************************************************/
+/* Reads out the saved wear counters of trigger 1 then trigger 2, each  */
+/* followed by a success blink: stuck open, stuck closed, bounces and   */
+/* the worst lag in ms.  Counts over 255 read out as 255.               */
+/************************************************************************/
+void switchHealthMenu() {
+	switch_health health[2];
+
+	trigger_loadHealth(health);
+
+	for (uint8_t i = 0; i < 2; i++) {
+		uint16_t counts[] = {health[i].stuckOpen, health[i].stuckClosed,
+			health[i].bounces, health[i].worstLag};
+
+		delay_ms(500);
+		for (uint8_t j = 0; j < 4; j++) {
+			showNumber(counts[j] > 255 ? 255 : counts[j]);
+			delay_ms(DIGIT_GAP);
+		}
+		successBlink();
 	}
 }
 
@@ -357,14 +453,24 @@ void handleConfig() {
 		if (selectedMenu == 0) {
 			firingModeMenu();
 		} else if (selectedMenu == 1) {
-			rateOfFireMenu();
+			numberMenu(&BALLS_PER_SECOND, EEPROM_BALLS_PER_SECOND[0], 5, 40);
 		} else if (selectedMenu == 2) {
-			burstSizeMenu();
+			numberMenu(&BURST_SIZE, EEPROM_BURST_SIZE[0], 2, 10);
 		} else if (selectedMenu == 3) {
-			ammoLimitMenu();
+			numberMenu(&AMMO_LIMIT, EEPROM_AMMO_LIMIT[0], 0, 250);
 		} else if (selectedMenu == 4) {
-			safetyShotMenu();
+			numberMenu(&SAFETY_SHOT, EEPROM_SAFETY_SHOT[0], 0, 5);
+		} else if (selectedMenu == 5) {
+			numberMenu(&BUFFER_DEPTH, EEPROM_BUFFER_DEPTH[0], 0, MAX_BUFFER_DEPTH);
+		} else if (selectedMenu == 6) {
+			battery_reset();
+			successBlink();
+		} else if (selectedMenu == 7) {
+			switchHealthMenu();
 		}
+
+		// The menu ISR stacks on top of the menu loop, keep the worst case for service
+		stack_check();
 	}			
 }
 
@@ -0,0 +1,110 @@
+/*
+This file is part of mad-phenom.
+
+mad-phenom is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+mad-phenom is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with mad-phenom.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef PINS_H_
+#define PINS_H_
+
+#include <avr/io.h>
+#include <stdbool.h>
+
+/************************************************************************/
+/* Compile-time pin map.  Each signal is described by its DDR, PORT,    */
+/* PIN register and bit.  Every register on the ATtiny24/44/84 lives in */
+/* the low I/O space, so with constant operands the access macros below */
+/* compile to a single sbi/cbi (writes) or sbis/sbic (reads).           */
+/*                                                                      */
+/* Select a board with -DBOARD=BOARD_<name>, a build that names none   */
+/* gets the X7 Classic.  Naming a board that has no pin map below is an */
+/* error.  The simulator builds against host stand-ins for the same     */
+/* registers.                                                           */
+/************************************************************************/
+
+#define BOARD_X7_CLASSIC 1
+
+#if !defined(BOARD)
+#define BOARD BOARD_X7_CLASSIC
+#endif
+
+#if BOARD == BOARD_X7_CLASSIC
+
+// Pin 12 - Red LED
+#define LED_RED_DDR    DDRA
+#define LED_RED_PORT   PORTA
+#define LED_RED_PIN    PINA
+#define LED_RED_BIT    PINA1
+
+// Pin 11 - Green LED
+#define LED_GREEN_DDR  DDRA
+#define LED_GREEN_PORT PORTA
+#define LED_GREEN_PIN  PINA
+#define LED_GREEN_BIT  PINA2
+
+// Pin 10 - Power latch (pulling it low powers the board down)
+#define POWER_DDR      DDRA
+#define POWER_PORT     PORTA
+#define POWER_PIN      PINA
+#define POWER_BIT      PINA3
+
+// Pin 6 - Solenoid
+#define SOLENOID_DDR   DDRA
+#define SOLENOID_PORT  PORTA
+#define SOLENOID_PIN   PINA
+#define SOLENOID_BIT   PINA7
+
+// Pin 3 - Push button (PCINT9)
+#define BUTTON_DDR     DDRB
+#define BUTTON_PORT    PORTB
+#define BUTTON_PIN     PINB
+#define BUTTON_BIT     PINB1
+
+// Pin 5 - Trigger switch 1 (PCINT10)
+#define TRIGGER_1_DDR  DDRB
+#define TRIGGER_1_PORT PORTB
+#define TRIGGER_1_PIN  PINB
+#define TRIGGER_1_BIT  PINB2
+
+// Pin 7 - Trigger switch 2
+#define TRIGGER_2_DDR  DDRA
+#define TRIGGER_2_PORT PORTA
+#define TRIGGER_2_PIN  PINA
+#define TRIGGER_2_BIT  PINA6
+
+// Pin 2 - Selector switch (closed = FA)
+#define SELECTOR_DDR   DDRB
+#define SELECTOR_PORT  PORTB
+#define SELECTOR_PIN   PINB
+#define SELECTOR_BIT   PINB0
+
+#else
+#error "Unknown board variant"
+#endif
+
+/************************************************************************/
+/* Access macros, name is one of the signals above (e.g. SOLENOID)      */
+/************************************************************************/
+#define PIN_OUTPUT(name)       (name##_DDR |= (1 << name##_BIT))
+#define PIN_INPUT_PULLUP(name) do { name##_DDR &= ~(1 << name##_BIT); name##_PORT |= (1 << name##_BIT); } while (0)
+#define PIN_HIGH(name)         (name##_PORT |= (1 << name##_BIT))
+#define PIN_LOW(name)          (name##_PORT &= ~(1 << name##_BIT))
+#define PIN_IS_HIGH(name)      ((name##_PIN & (1 << name##_BIT)) != 0)
+
+// All switches pull their pin to ground when closed
+#define PIN_CLOSED(name)       (!PIN_IS_HIGH(name))
+
+#define TRIGGER_HELD()         (PIN_CLOSED(TRIGGER_1) || PIN_CLOSED(TRIGGER_2))
+#define TRIGGER_RELEASED()     (!PIN_CLOSED(TRIGGER_1) && !PIN_CLOSED(TRIGGER_2))
+
+#endif /* PINS_H_ */
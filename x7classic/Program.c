@@ -0,0 +1,78 @@
+/*
+This file is part of mad-phenom.
+
+mad-phenom is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+mad-phenom is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with mad-phenom.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <avr/pgmspace.h>
+#include "Program.h"
+#include "Globals.h"
+#include "Trainer.h"
+#include "Common.h"
+
+uint8_t EEMEM EEPROM_PROGRAM[2][MAX_PRESETS][PROGRAM_SIZE];
+
+uint8_t firingProgram[PROGRAM_SIZE];
+bool programBuffered = false; // Queued shots go through the shot buffer
+
+const uint8_t stockPrograms[4][PROGRAM_SIZE] PROGMEM = {
+	{ OP_PULL | 1, OP_REPEAT | OP_SAFE | 0 },           // Full Auto
+	{ OP_PULL | OP_SAFE | 0 },                          // Burst
+	{ OP_PULL_ADD | 1, OP_RELEASE | OP_SAFE | 1 },      // Auto Response
+	{ OP_PULL | 1 },                                    // Semi-Auto
+};
+
+/************************************************************************/
+/* Loads the program for FIRING_MODE into RAM.  A custom program that   */
+/* can never fire a shot falls back to semi-auto.  The trainer runs an  */
+/* empty program so the trigger is measured but nothing fires.          */
+/************************************************************************/
+void program_load() {
+	bool fires = false;
+
+	programBuffered = false;
+
+	for (uint8_t i = 0; i < PROGRAM_SIZE; i++) {
+		uint8_t op = OP_END;
+
+		if (FIRING_MODE == MODE_CUSTOM) {
+			op = eeprom_read_byte(EEPROM_PROGRAM[0][presetSlot()] + i);
+		} else if (FIRING_MODE < MODE_CUSTOM) {
+			op = pgm_read_byte(&stockPrograms[FIRING_MODE][i]);
+		}
+
+		if ((op & OP_MASK) > OP_LAST) {
+			op = OP_END;
+		}
+
+		switch (op & OP_MASK) {
+			case OP_PULL:
+				fires = true;
+				break;
+			case OP_PULL_ADD:
+			case OP_RELEASE:
+				fires = true;
+				programBuffered = true;
+				break;
+		}
+
+		firingProgram[i] = op;
+	}
+
+	if (!fires && FIRING_MODE != MODE_TRAINER) {
+		for (uint8_t i = 0; i < PROGRAM_SIZE; i++) {
+			firingProgram[i] = pgm_read_byte(&stockPrograms[3][i]);
+		}
+		programBuffered = false;
+	}
+}
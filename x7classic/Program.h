@@ -0,0 +1,78 @@
+/*
+This file is part of mad-phenom.
+
+mad-phenom is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+mad-phenom is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with mad-phenom.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef PROGRAM_H_
+#define PROGRAM_H_
+
+#include <avr/io.h>
+#include <avr/eeprom.h>
+#include <stdbool.h>
+#include "Globals.h"
+
+/************************************************************************/
+/* Firing programs.  Each firing mode is a short program the trigger    */
+/* engine interprets on three events: pull, held (once per ROUND_DELAY  */
+/* while the trigger stays down) and release.                           */
+/*                                                                      */
+/* One instruction per byte:  [op:3][S:1][arg:4]                        */
+/*                                                                      */
+/*   END          stop                                                  */
+/*   PULL n       on pull, queue n shots (0 = BURST_SIZE)               */
+/*                S: a single shot until the safety shots are reached   */
+/*   PULL_ADD n   on pull, add n shots to the queue                     */
+/*   RELEASE n    on release (held less than 2s), add n shots           */
+/*   REPEAT m     while held, one shot at the cap once m shots of this  */
+/*                pull have fired                                       */
+/*   IF_RATE x    run the next instruction only while the trigger is    */
+/*                pulled faster than x pulls per second                 */
+/*                                                                      */
+/* S on PULL_ADD, RELEASE and REPEAT skips the instruction until the    */
+/* safety shots are reached.  Unknown opcodes read as END.              */
+/*                                                                      */
+/* FIRING_MODE 0-3 run the stock programs from flash.  FIRING_MODE 4    */
+/* runs the program stored in EEPROM for the preset, so new behaviours  */
+/* can be loaded with an EEPROM write instead of a reflash.             */
+/* FIRING_MODE 5 is the pull speed trainer (Trainer.h), it never fires. */
+/************************************************************************/
+
+#define PROGRAM_SIZE 8
+
+#define OP_END      0x00
+#define OP_PULL     0x20
+#define OP_PULL_ADD 0x40
+#define OP_RELEASE  0x60
+#define OP_REPEAT   0x80
+#define OP_IF_RATE  0xA0
+#define OP_LAST     OP_IF_RATE
+
+#define OP_SAFE     0x10
+#define OP_MASK     0xE0
+#define ARG_MASK    0x0F
+
+#define PROGRAM_PULL    0
+#define PROGRAM_HELD    1
+#define PROGRAM_RELEASE 2
+
+#define MODE_CUSTOM 4
+
+extern uint8_t EEMEM EEPROM_PROGRAM[2][MAX_PRESETS][PROGRAM_SIZE];
+
+extern uint8_t firingProgram[PROGRAM_SIZE];
+extern bool programBuffered;
+
+void program_load();
+
+#endif /* PROGRAM_H_ */
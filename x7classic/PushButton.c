@@ -18,19 +18,30 @@ along with mad-phenom.  If not, see <http://www.gnu.org/licenses/>.
 #include "PushButton.h"
 #include "Common.h"
 #include "Globals.h"
+#include "Pins.h"
+#include "Battery.h"
+#include "Trainer.h"
+#include "Trigger.h"
 
 bool pushbutton_down = false;
 uint32_t pushbutton_activeTime = 0;
 uint32_t pushbutton_indicatorTime = 0;
 uint8_t pushbutton_currentBlink = 0;
 bool pushbutton_indicatorOn = false;
+bool pushbutton_readout = false;  // A readout replaces the preset indicator for one group
+uint8_t pushbutton_readoutRed = 0;
+uint8_t pushbutton_readoutGreen = 0;
+bool pushbutton_poweringDown = false;
+bool pushbutton_bootHeld = false;  // Held since power on, may become a config request
+bool selector_closed = false;
+uint32_t selector_changeTime = 0;
 
 void pushbutton_run(volatile uint32_t *millis) {
 	
 	bool pastDebounce = ((*millis) - pushbutton_activeTime) > PULL_DEBOUNCE;
 
 	// Check if the push button was pushed
-	if (!pushbutton_down && pushButtonHasInput() && pastDebounce) {
+	if (!pushbutton_down && !pushbutton_bootHeld && pushButtonHasInput() && pastDebounce) {
 
 		pushbutton_down = true;
 		redOn();
@@ -44,9 +55,14 @@ void pushbutton_run(volatile uint32_t *millis) {
 
 		// This is used to power down the X7 classic
 		if (((*millis) - pushbutton_activeTime) > 5000) {
+			if (!pushbutton_poweringDown) {
+				pushbutton_poweringDown = true;
+				battery_save();
+				trigger_saveHealth();
+			}
+
 			// Power down
-			//PORTA &= ~(1 << PINA0); // 13 - LOW
-			PORTA &= ~(1 << PINA3); // 10 - LOW
+			PIN_LOW(POWER);
 		}
 	}
 
@@ -54,9 +70,17 @@ void pushbutton_run(volatile uint32_t *millis) {
 	if (pushbutton_down && !pushButtonHasInput() && pastDebounce) {
 		if (((*millis) - pushbutton_activeTime) > 100) {
 			togglePreset();
+			pushbutton_readout = false;
 			pushbutton_currentBlink = 0;
 			pushbutton_indicatorOn   = false;
 			pushbutton_indicatorTime = (*millis);
+		} else if (FIRING_MODE == MODE_TRAINER) {
+			// A quick tap shows the sustained rate of the last string
+			uint8_t rate = trainer_sustainedRate(&trainer_last);
+			pushbutton_showReadout(rate / 10, rate % 10, (*millis));
+		} else {
+			// A quick tap shows the shots remaining in red
+			pushbutton_showReadout(battery_blinks(), 0, (*millis));
 		}
 
 		pushbutton_down       = false;
@@ -65,9 +89,15 @@ void pushbutton_run(volatile uint32_t *millis) {
 	}
 	
 	// This code will turn the green LED on and off to signify which preset is active
-	if (!pushbutton_indicatorOn && ((*millis) - pushbutton_indicatorTime) > 200 && pushbutton_currentBlink < (CURRENT_PRESET[currentSelector] + 1)) {
+	uint8_t blinks = pushbutton_readout ? (pushbutton_readoutRed + pushbutton_readoutGreen) : (CURRENT_PRESET[currentSelector] + 1);
 
-		if (AMMO_LIMIT > 0 && shotsFired >= AMMO_LIMIT) {
+	if (!pushbutton_indicatorOn && ((*millis) - pushbutton_indicatorTime) > 200 && pushbutton_currentBlink < blinks) {
+
+		if (pushbutton_readout) {
+			redSet(pushbutton_currentBlink < pushbutton_readoutRed);
+			greenSet(pushbutton_currentBlink >= pushbutton_readoutRed);
+		} else if ((AMMO_LIMIT > 0 && shotsFired >= AMMO_LIMIT)
+			|| battery_low()) {
 			redOn();
 		} else {
 			greenOn();
@@ -84,20 +114,61 @@ void pushbutton_run(volatile uint32_t *millis) {
 		pushbutton_indicatorTime = (*millis);
 	}
 	
-	if (!pushbutton_indicatorOn && ((*millis) - pushbutton_indicatorTime) > 1000 && pushbutton_currentBlink >= (CURRENT_PRESET[currentSelector] + 1)) {
+	if (!pushbutton_indicatorOn && ((*millis) - pushbutton_indicatorTime) > 1000 && pushbutton_currentBlink >= blinks) {
+		pushbutton_readout = false;
 		pushbutton_currentBlink = 0;
 	}
 
-	// Check the selector switch
-	if ((PINB & (1 << PINB0)) <= 0) {
-		if (currentSelector == 0) {
-			currentSelector = 1; // Mode (FA)
-			loadPreset();
-		}
-	} else {
-		if (currentSelector == 1) {
-			currentSelector = 0; // Mode (F)
-			loadPreset();
+	// Check the selector switch, it has to settle before it counts
+	if (PIN_CLOSED(SELECTOR) != selector_closed) {
+		selector_closed = !selector_closed;
+		selector_changeTime = (*millis);
+	}
+
+	if (((*millis) - selector_changeTime) >= SELECTOR_DEBOUNCE) {
+		uint8_t selector = selector_closed ? 1 : 0; // Mode (FA) : Mode (F)
+
+		if (selector != currentSelector) {
+			currentSelector = selector;
+
+			// Takes effect at the next shot boundary
+			stagePreset();
 		}
 	}
-}
\ No newline at end of file
+}
+
+/************************************************************************/
+/* Shows red blinks then green blinks once in place of the preset       */
+/************************************************************************/
+void pushbutton_showReadout(uint8_t red, uint8_t green, uint32_t millisecond) {
+	pushbutton_readout = true;
+	pushbutton_readoutRed = red;
+	pushbutton_readoutGreen = green;
+	pushbutton_currentBlink = 0;
+	pushbutton_indicatorOn   = false;
+	pushbutton_indicatorTime = millisecond;
+}
+
+void pushbutton_boot() {
+	pushbutton_bootHeld = pushButtonHasInput();
+}
+
+/************************************************************************/
+/* Config mode is asked for by holding the button from power on for     */
+/* CONFIG_HOLD_TIME.  The firing core is already running while that is  */
+/* decided, a shorter hold is ignored.                                  */
+/************************************************************************/
+bool pushbutton_configRequested(volatile uint32_t *millis) {
+	if (!pushbutton_bootHeld) {
+		return false;
+	}
+
+	if (!pushButtonHasInput()) {
+		// Let the release bounce settle before the button counts again
+		pushbutton_bootHeld = false;
+		pushbutton_activeTime = (*millis);
+		return false;
+	}
+
+	return (*millis) >= CONFIG_HOLD_TIME;
+}
@@ -19,6 +19,13 @@ along with mad-phenom.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <avr/io.h>
 
+#include <stdbool.h>
+
 void pushbutton_run(volatile uint32_t *millis);
+void pushbutton_showReadout(uint8_t red, uint8_t green, uint32_t millisecond);
+void pushbutton_boot();
+bool pushbutton_configRequested(volatile uint32_t *millis);
+
+extern bool pushbutton_poweringDown;
 
 #endif /* PUSHBUTTON_H_ */
\ No newline at end of file
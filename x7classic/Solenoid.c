@@ -18,6 +18,7 @@ along with mad-phenom.  If not, see <http://www.gnu.org/licenses/>.
 #include "Solenoid.h"
 #include "Globals.h"
 #include "Common.h"
+#include "Battery.h"
 
 bool solenoidDone = true;
 bool solenoidActive = false;
@@ -48,6 +49,8 @@ void solenoid_run(volatile uint32_t *millis) {
 		solenoidOff();
 		solenoidDone = true;
 		solenoidActive = false;
+
+		battery_shot((*millis) - activeTime, (*millis));
 	}
 }
 
@@ -0,0 +1,110 @@
+/*
+This file is part of mad-phenom.
+
+mad-phenom is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+mad-phenom is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with mad-phenom.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <avr/io.h>
+#include <avr/eeprom.h>
+#include "Stack.h"
+
+extern uint8_t _end;
+extern uint8_t __stack;
+
+// Lowest stack_unused() seen since it was last erased, readable over ISP
+uint8_t EEMEM EEPROM_STACK_UNUSED;
+
+uint8_t stack_lowest = 0xFF;  // Lowest stack_unused() seen since reset
+uint32_t stack_checkTime = 0;
+
+void stack_paint() __attribute__ ((naked)) __attribute__ ((section (".init1")));
+
+/************************************************************************/
+/* Runs from .init1, before the stack pointer and r1 are set up, so it  */
+/* must not touch the stack or rely on r1 being zero.                   */
+/************************************************************************/
+void stack_paint() {
+	__asm volatile (
+		"    ldi r30, lo8(_end)\n"
+		"    ldi r31, hi8(_end)\n"
+		"    ldi r24, %0\n"
+		"    ldi r25, hi8(__stack)\n"
+		"    rjmp 2f\n"
+		"1:\n"
+		"    st Z+, r24\n"
+		"2:\n"
+		"    cpi r30, lo8(__stack)\n"
+		"    cpc r31, r25\n"
+		"    brlo 1b\n"
+		"    breq 1b\n"
+		:: "M" (STACK_CANARY));
+}
+
+/************************************************************************/
+/* Bytes of SRAM that have never been touched by the stack              */
+/************************************************************************/
+uint16_t stack_unused() {
+	const uint8_t *p = &_end;
+	uint16_t count = 0;
+
+	while (p <= &__stack && *p == STACK_CANARY) {
+		p++;
+		count++;
+	}
+
+	return count;
+}
+
+/************************************************************************/
+/* Deepest stack use since reset, in bytes                              */
+/************************************************************************/
+uint16_t stack_highWater() {
+	return (uint16_t)(&__stack - &_end + 1) - stack_unused();
+}
+
+/************************************************************************/
+/* Keeps stack_lowest at the lowest stack_unused() seen.  The scan      */
+/* walks all of free SRAM, so the run loop only calls this between      */
+/* strings.                                                             */
+/************************************************************************/
+void stack_check() {
+	uint16_t unused = stack_unused();
+
+	if (unused < stack_lowest) {
+		stack_lowest = unused;
+	}
+}
+
+/************************************************************************/
+/* At most one stack_check() every STACK_CHECK_INTERVAL                 */
+/************************************************************************/
+void stack_run(volatile uint32_t *millis) {
+	if ((*millis) - stack_checkTime < STACK_CHECK_INTERVAL) {
+		return;
+	}
+
+	stack_checkTime = (*millis);
+	stack_check();
+}
+
+/************************************************************************/
+/* Called on power down, lowers EEPROM_STACK_UNUSED to stack_lowest.    */
+/* Waits for any battery write still in progress.                       */
+/************************************************************************/
+void stack_save() {
+	stack_check();
+
+	if (stack_lowest < eeprom_read_byte(&EEPROM_STACK_UNUSED)) {
+		eeprom_write_byte(&EEPROM_STACK_UNUSED, stack_lowest);
+	}
+}
@@ -0,0 +1,42 @@
+/*
+This file is part of mad-phenom.
+
+mad-phenom is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+mad-phenom is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with mad-phenom.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef STACK_H_
+#define STACK_H_
+
+#include <avr/io.h>
+#include <avr/eeprom.h>
+
+/************************************************************************/
+/* Stack painting.  Free SRAM between the end of .bss/.noinit (_end)    */
+/* and the top of the stack is filled with STACK_CANARY before main     */
+/* runs; the deepest stack excursion since reset is wherever the paint  */
+/* stops.                                                               */
+/************************************************************************/
+
+#define STACK_CANARY 0xC5
+#define STACK_CHECK_INTERVAL 1000  // ms between high-water scans in the run loop
+
+uint16_t stack_unused();
+uint16_t stack_highWater();
+void stack_check();
+void stack_run(volatile uint32_t *millis);
+void stack_save();
+
+extern uint8_t EEMEM EEPROM_STACK_UNUSED;
+extern uint8_t stack_lowest;
+
+#endif /* STACK_H_ */
@@ -0,0 +1,158 @@
+/*
+This file is part of mad-phenom.
+
+mad-phenom is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+mad-phenom is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with mad-phenom.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <avr/io.h>
+#include <avr/eeprom.h>
+#include <stdbool.h>
+#include "Trainer.h"
+#include "Globals.h"
+#include "PushButton.h"
+
+trainer_result trainer_last = {0xFFFF, 0xFFFF};
+trainer_result trainer_best = {0xFFFF, 0xFFFF};
+
+trainer_result EEMEM EEPROM_TRAINER[2];
+
+// The string in progress
+trainer_result trainer_string;
+uint16_t trainer_window[TRAINER_PEAK_INTERVALS]; // Times of the last pulls, low 16 bits of millis
+uint8_t trainer_windowHead = 0;
+uint16_t trainer_average = 0;
+uint8_t trainer_intervals = 0;
+uint32_t trainer_lastPull = 0;
+bool trainer_active = false;
+bool trainer_loaded = false;
+
+// Bytes of EEPROM_TRAINER still to write, counting down, one per pass
+uint8_t trainer_pendingBytes = 0;
+
+/************************************************************************/
+/* Called from the trigger on every debounced pull.  Keep it short, it  */
+/* runs in the firing path of every mode.                               */
+/*                                                                      */
+/* interval - ms since the previous pull                                */
+/************************************************************************/
+void trainer_pull(uint16_t interval, uint32_t millisecond) {
+	// Intervals within a string are under TRAINER_STRING_GAP, so the span
+	// of the last few is the time since the pull that many back
+	uint16_t span = (uint16_t) millisecond - trainer_window[trainer_windowHead];
+
+	trainer_lastPull = millisecond;
+	trainer_window[trainer_windowHead] = millisecond;
+	if (++trainer_windowHead >= TRAINER_PEAK_INTERVALS) {
+		trainer_windowHead = 0;
+	}
+
+	// First pull of a new string
+	if (!trainer_active || interval > TRAINER_STRING_GAP) {
+		trainer_active = true;
+		trainer_string.peakSpan = 0xFFFF;
+		trainer_string.average = 0xFFFF;
+		trainer_intervals = 0;
+		return;
+	}
+
+	if (trainer_intervals < 255) {
+		trainer_intervals++;
+	}
+
+	if (trainer_intervals >= TRAINER_PEAK_INTERVALS && span < trainer_string.peakSpan) {
+		trainer_string.peakSpan = span;
+	}
+
+	// Running average, seeded with the first interval
+	if (trainer_intervals == 1) {
+		trainer_average = interval << TRAINER_AVERAGE_SHIFT;
+	} else {
+		trainer_average += interval - (trainer_average >> TRAINER_AVERAGE_SHIFT);
+	}
+
+	if (trainer_intervals >= (1 << TRAINER_AVERAGE_SHIFT) && trainer_average < trainer_string.average) {
+		trainer_string.average = trainer_average;
+	}
+}
+
+void trainer_run(volatile uint32_t *millis) {
+	uint32_t now = (*millis);
+
+	if (!trainer_loaded) {
+		eeprom_read_block(&trainer_best, &EEPROM_TRAINER[1], sizeof(trainer_result));
+		trainer_loaded = true;
+	}
+
+	// Same as the battery account, never wait on the EEPROM.  The results
+	// only change once a string has ended, a second after the last pull,
+	// so they are written straight from trainer_last and trainer_best.
+	if (trainer_pendingBytes > 0 && eeprom_is_ready()) {
+		uint8_t index = --trainer_pendingBytes;
+		const uint8_t *source = (index < sizeof(trainer_result))
+			? ((const uint8_t *) &trainer_last) + index
+			: ((const uint8_t *) &trainer_best) + index - sizeof(trainer_result);
+
+		eeprom_update_byte(((uint8_t *) EEPROM_TRAINER) + index, *source);
+	}
+
+	if (!trainer_active || (now - trainer_lastPull) <= TRAINER_STRING_GAP) {
+		return;
+	}
+
+	trainer_active = false;
+
+	// Too short to say anything about
+	if (trainer_intervals < TRAINER_PEAK_INTERVALS) {
+		return;
+	}
+
+	trainer_last = trainer_string;
+
+	// Only trainer mode strings count towards the best and are kept, the
+	// best is only rewritten when it moved
+	if (FIRING_MODE == MODE_TRAINER) {
+		bool improved = false;
+		if (trainer_last.peakSpan < trainer_best.peakSpan) {
+			trainer_best.peakSpan = trainer_last.peakSpan;
+			improved = true;
+		}
+		if (trainer_last.average < trainer_best.average) {
+			trainer_best.average = trainer_last.average;
+			improved = true;
+		}
+
+		trainer_pendingBytes = improved ? sizeof(EEPROM_TRAINER) : sizeof(trainer_result);
+
+		uint8_t rate = trainer_peakRate(&trainer_last);
+		pushbutton_showReadout(rate / 10, rate % 10, now);
+	}
+}
+
+/************************************************************************/
+/* Whole pulls per second, 0 when there is no result                    */
+/************************************************************************/
+uint8_t trainer_peakRate(const trainer_result *result) {
+	if (result->peakSpan == 0 || result->peakSpan == 0xFFFF) {
+		return 0;
+	}
+
+	return (TRAINER_PEAK_INTERVALS * 1000U + result->peakSpan / 2) / result->peakSpan;
+}
+
+uint8_t trainer_sustainedRate(const trainer_result *result) {
+	if (result->average == 0 || result->average == 0xFFFF) {
+		return 0;
+	}
+
+	return ((1000U << TRAINER_AVERAGE_SHIFT) + result->average / 2) / result->average;
+}
@@ -0,0 +1,63 @@
+/*
+This file is part of mad-phenom.
+
+mad-phenom is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+mad-phenom is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with mad-phenom.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef TRAINER_H_
+#define TRAINER_H_
+
+#include <avr/io.h>
+#include <avr/eeprom.h>
+#include <stdbool.h>
+
+/************************************************************************/
+/* Pull speed measurement.  Every debounced pull is timed, in every     */
+/* firing mode; a string ends after TRAINER_STRING_GAP without a pull.  */
+/*                                                                      */
+/*   peak       - fastest TRAINER_PEAK_INTERVALS consecutive intervals  */
+/*   sustained  - best running average over about                       */
+/*                (1 << TRAINER_AVERAGE_SHIFT) intervals, once the      */
+/*                string is that long                                   */
+/*                                                                      */
+/* The pull path only keeps pull times and minimums, rates are worked   */
+/* out when they are shown.  In the trainer firing mode the solenoid    */
+/* never fires; the peak of each string is shown as red blinks for tens */
+/* and green blinks for ones, and a tap of the button shows the         */
+/* sustained rate the same way.  Only strings pulled in the trainer     */
+/* mode count towards the best and are written to EEPROM.               */
+/************************************************************************/
+
+#define MODE_TRAINER 5
+
+#define TRAINER_STRING_GAP 1000    // ms without a pull that ends a string
+#define TRAINER_PEAK_INTERVALS 3
+#define TRAINER_AVERAGE_SHIFT 3
+
+typedef struct {
+	uint16_t peakSpan;    // ms taken by the fastest TRAINER_PEAK_INTERVALS intervals
+	uint16_t average;     // Best running average interval, ms << TRAINER_AVERAGE_SHIFT
+} trainer_result;
+
+extern trainer_result trainer_last;  // The last finished string
+extern trainer_result trainer_best;  // Best since the EEPROM was cleared
+
+// Last string then best, erased EEPROM reads as no result
+extern trainer_result EEMEM EEPROM_TRAINER[2];
+
+void trainer_pull(uint16_t interval, uint32_t millisecond);
+void trainer_run(volatile uint32_t *millis);
+uint8_t trainer_peakRate(const trainer_result *result);
+uint8_t trainer_sustainedRate(const trainer_result *result);
+
+#endif /* TRAINER_H_ */
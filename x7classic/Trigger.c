@@ -18,14 +18,34 @@ along with mad-phenom.  If not, see <http://www.gnu.org/licenses/>.
 #include "Globals.h"
 #include "Common.h"
 #include "Solenoid.h"
-
-uint32_t trigger_activeTime = 0;
+#include "Trigger.h"
+#include "Pins.h"
+#include "Program.h"
+#include "Trainer.h"
+
+// Both start well before reset so neither the release debounce nor the
+// rate cap holds up the first pull after power on
+uint32_t trigger_activeTime = (uint32_t) -256;
 uint32_t trigger_heldTime = 0;
-uint32_t queue_activeTime = 0;
+uint32_t queue_activeTime = (uint32_t) -256;
+bool queue_capHeld = false;   // The rate cap held back a queued shot last pass
+bool queue_midTick = false;   // The last shot left part way through a millis tick
 uint32_t lastTriggerPullTime = 0;
 uint8_t safetyShotsFired = 0;
 bool trigger_pulled = false;
 uint8_t firing_queue = 0;
+uint8_t pullShotsFired = 0;     // Shots fired since the trigger was pulled
+uint16_t pullInterval = 0xFFFF; // Time between the last two pulls (ms)
+trigger_switch trigger_switches[2];
+
+switch_health EEMEM EEPROM_SWITCH_HEALTH[2];
+
+// Time each auto response shot was queued, oldest at shotBufferHead
+uint16_t shotBuffer[MAX_BUFFER_DEPTH + 1];
+uint8_t shotBufferHead = 0;
+#ifndef __AVR__
+buffer_statistics buffer_stats;
+#endif
 
 //void trigger_singleShot(uint32_t *millis);
 //void trigger_fullAuto(uint32_t *millis);
@@ -33,14 +53,6 @@ uint8_t firing_queue = 0;
 //void trigger_burst(uint32_t *millis);
 //void fireFromQueue(uint32_t *millis);
 
-//bool triggerHeld() {
-//	return ((PINB & (1 << PINB2)) <= 0) || ((PINA & (1 << PINA6)) <= 0);
-//}
-
-//bool triggerReleased() {
-//	return (((PINB & (1 << PINB2)) > 0) && ((PINA & (1 << PINA6)) > 0));
-//}
-
 //bool checkPullDebounce(uint32_t *millis) {
 //	return (((*millis) - trigger_activeTime) >= PULL_DEBOUNCE);
 //}
@@ -54,93 +66,333 @@ uint8_t firing_queue = 0;
 //	trigger_pulled = false;
 //}
 
+// Switch counters stop at the top rather than wrap
+void countUp(uint16_t *count) {
+	if (*count < 0xFFFF) {
+		(*count)++;
+	}
+}
+
+void updateSwitch(trigger_switch *sw, bool raw, uint32_t now) {
+	uint16_t sinceEdge = (uint16_t) now - sw->edgeTime;
+
+	if (raw != sw->raw) {
+		sw->raw = raw;
+
+		if (sinceEdge < SWITCH_DEBOUNCE) {
+			countUp(&sw->health.bounces);
+		}
+	}
+
+	// Accept the first edge straight away, then lock out the bounce
+	if (sw->raw != sw->closed && sinceEdge >= SWITCH_DEBOUNCE) {
+		sw->closed = sw->raw;
+		sw->edgeTime = now;
+
+		if (!sw->closed) {
+			sw->stuckReported = false;
+		}
+	}
+}
+
+/************************************************************************/
+/* Lag and stuck switch accounting for one switch, once per pass.  Edge */
+/* times are 16 bit, they are only ever compared within                 */
+/* SWITCH_STUCK_TIME of now.                                            */
+/************************************************************************/
+void switchHealth(trigger_switch *sw, trigger_switch *other, uint32_t now) {
+	if (sw->lagPending && sw->closed) {
+		uint16_t lag = sw->edgeTime - (uint16_t) trigger_heldTime;
+
+		sw->lastLag = (lag > 255) ? 255 : lag;
+		if (sw->lastLag > sw->health.worstLag) {
+			sw->health.worstLag = sw->lastLag;
+		}
+		sw->lagPending = false;
+	} else if (sw->lagPending && (now - trigger_heldTime) >= SWITCH_STUCK_TIME) {
+		countUp(&sw->health.stuckOpen);
+		sw->lagPending = false;
+	}
+
+	if (sw->closed && !other->closed && !sw->stuckReported) {
+		// Only stuck closed if the other switch has been closed and let
+		// go since this one closed, otherwise it is the other that failed
+		bool otherMoved = (int16_t)(other->edgeTime - sw->edgeTime) > 0;
+		uint16_t alone = (uint16_t) now - (otherMoved ? other->edgeTime : sw->edgeTime);
+
+		if (alone >= SWITCH_STUCK_TIME) {
+			if (otherMoved) {
+				countUp(&sw->health.stuckClosed);
+			} else if ((int16_t)((uint16_t) trigger_heldTime - sw->edgeTime) < 0) {
+				// A pull started after this switch closed has already
+				// counted the other's miss through lagPending
+				countUp(&other->health.stuckOpen);
+			}
+			sw->stuckReported = true;
+		}
+	}
+}
+
+void checkSwitchHealth(uint32_t now) {
+	switchHealth(&trigger_switches[0], &trigger_switches[1], now);
+	switchHealth(&trigger_switches[1], &trigger_switches[0], now);
+}
+
+/************************************************************************/
+/* Reads the saved totals for both switches                             */
+/************************************************************************/
+void trigger_loadHealth(switch_health *health) {
+	uint8_t *bytes = (uint8_t *) health;
+	bool erased = true;
+
+	eeprom_read_block(health, EEPROM_SWITCH_HEALTH, sizeof(EEPROM_SWITCH_HEALTH));
+
+	for (uint8_t i = 0; i < sizeof(EEPROM_SWITCH_HEALTH); i++) {
+		erased = erased && bytes[i] == 0xFF;
+	}
+
+	// Erased EEPROM, nothing has been counted yet
+	if (erased) {
+		for (uint8_t i = 0; i < sizeof(EEPROM_SWITCH_HEALTH); i++) {
+			bytes[i] = 0;
+		}
+	}
+}
+
+uint16_t addCount(uint16_t total, uint16_t count) {
+	uint16_t sum = total + count;
+
+	return (sum < total) ? 0xFFFF : sum;
+}
+
+/************************************************************************/
+/* Adds the counts since power on to the saved totals, used on power    */
+/* down.  The counts start over, so a second save adds nothing.         */
+/************************************************************************/
+void trigger_saveHealth() {
+	switch_health total[2];
+
+	trigger_loadHealth(total);
+
+	for (uint8_t i = 0; i < 2; i++) {
+		switch_health *counts = &trigger_switches[i].health;
+
+		total[i].bounces = addCount(total[i].bounces, counts->bounces);
+		total[i].leads = addCount(total[i].leads, counts->leads);
+		total[i].stuckOpen = addCount(total[i].stuckOpen, counts->stuckOpen);
+		total[i].stuckClosed = addCount(total[i].stuckClosed, counts->stuckClosed);
+		if (counts->worstLag > total[i].worstLag) {
+			total[i].worstLag = counts->worstLag;
+		}
+		counts->bounces = counts->leads = counts->stuckOpen = counts->stuckClosed = 0;
+		counts->worstLag = 0;
+	}
+
+	eeprom_update_block(total, EEPROM_SWITCH_HEALTH, sizeof(EEPROM_SWITCH_HEALTH));
+}
+
+/************************************************************************/
+/* Queues an auto response shot.  One shot can wait on the rate cap and */
+/* BUFFER_DEPTH more behind it, anything beyond that is dropped.        */
+/************************************************************************/
+void bufferShot(uint32_t now) {
+#ifndef __AVR__
+	if (buffer_stats.depth[firing_queue] == 0xFF) {
+		for (uint8_t i = 0; i < MAX_BUFFER_DEPTH + 2; i++) {
+			buffer_stats.depth[i] >>= 1;
+		}
+	}
+	buffer_stats.depth[firing_queue]++;
+#endif
+
+	if (firing_queue > BUFFER_DEPTH) {
+#ifndef __AVR__
+		if (buffer_stats.dropped < 0xFF) {
+			buffer_stats.dropped++;
+		}
+#endif
+		return;
+	}
+
+	uint8_t slot = shotBufferHead + firing_queue;
+	if (slot > MAX_BUFFER_DEPTH) {
+		slot -= MAX_BUFFER_DEPTH + 1;
+	}
+
+	shotBuffer[slot] = now;
+	firing_queue++;
+}
+
+uint16_t oldestShotAge(uint32_t now) {
+	return (uint16_t)((uint16_t)now - shotBuffer[shotBufferHead]);
+}
+
+/************************************************************************/
+/* Removes the oldest buffered shot, true if it is still fresh          */
+/************************************************************************/
+bool takeBufferedShot(uint32_t now) {
+	bool fresh = oldestShotAge(now) <= SHOT_EXPIRY;
+
+	if (++shotBufferHead > MAX_BUFFER_DEPTH) {
+		shotBufferHead = 0;
+	}
+	firing_queue--;
+
+#ifndef __AVR__
+	if (!fresh && buffer_stats.expired < 0xFF) {
+		buffer_stats.expired++;
+	}
+#endif
+
+	return fresh;
+}
+
+bool safetyReached() {
+	return safetyShotsFired >= SAFETY_SHOT || SAFETY_SHOT == 0;
+}
+
+void queueShots(uint8_t count, bool add, uint32_t now) {
+	if (!add) {
+		firing_queue = 0;
+	}
+
+	if (!programBuffered) {
+		firing_queue = (firing_queue + count > 250) ? 250 : firing_queue + count;
+		return;
+	}
+
+	while (count-- > 0) {
+		bufferShot(now);
+	}
+}
+
+/************************************************************************/
+/* Runs the firing program for one event.  The program is a fixed size  */
+/* and every instruction is a few compares, so the cost per pass is     */
+/* bounded no matter what is loaded.                                    */
+/************************************************************************/
+void runProgram(uint8_t event, uint32_t now) {
+	bool skip = false;
+
+	for (uint8_t i = 0; i < PROGRAM_SIZE; i++) {
+		uint8_t op = firingProgram[i] & OP_MASK;
+		uint8_t arg = firingProgram[i] & ARG_MASK;
+		// S holds an instruction back until the safety shots are reached
+		bool allowed = (firingProgram[i] & OP_SAFE) == 0 || safetyReached();
+
+		if (op == OP_END) {
+			break;
+		}
+
+		if (skip) {
+			skip = false;
+			continue;
+		}
+
+		switch (op) {
+			case OP_PULL:
+				if (event == PROGRAM_PULL) {
+					// Don't allow more than one shot if safety shots have not been reached
+					if (!allowed) {
+						arg = 1;
+					} else if (arg == 0) {
+						arg = BURST_SIZE;
+					}
+					queueShots(arg, false, now);
+				}
+				break;
+			case OP_PULL_ADD:
+				if (event == PROGRAM_PULL && allowed) {
+					queueShots(arg, true, now);
+				}
+				break;
+			case OP_RELEASE:
+				// If the trigger was held for 2 seconds or more, don't fire a round
+				if (event == PROGRAM_RELEASE && (now - trigger_heldTime) < 2000 && allowed) {
+					queueShots(arg, true, now);
+				}
+				break;
+			case OP_REPEAT:
+				if (event == PROGRAM_HELD) {
+					trigger_activeTime = now;
+
+					// FA needs to be greater than the safety shot
+					// since holding the trigger would auto-qualify the last safety shot.
+					if (pullShotsFired >= arg
+						&& ((firingProgram[i] & OP_SAFE) == 0 || safetyShotsFired > SAFETY_SHOT || SAFETY_SHOT == 0)) {
+						queueShots(1, false, now);
+					}
+				}
+				break;
+			case OP_IF_RATE:
+				// Faster than arg pulls per second.  32 bit, a 16 bit int
+				// product wraps for long intervals.
+				skip = ((uint32_t) arg * pullInterval) >= 1000;
+				break;
+		}
+	}
+}
+
 void trigger_run(volatile uint32_t *millis) {
 	
+	updateSwitch(&trigger_switches[0], PIN_CLOSED(TRIGGER_1), *millis);
+	updateSwitch(&trigger_switches[1], PIN_CLOSED(TRIGGER_2), *millis);
+
+	bool triggerHeld = trigger_switches[0].closed || trigger_switches[1].closed;
+
+	// A new preset waits until a burst or queued shots have left on the old settings
+	if (presetStaged && firing_queue == 0) {
+		applyPreset();
+	}
+
 	//////// TRIGGER PULLED
 	
 	bool pastPullDebounce = (((*millis) - trigger_activeTime) >= PULL_DEBOUNCE);
 
 	// NOTE: Burst originally used checkPullDebounce()
 	if (!trigger_pulled
-		&& (((PINB & (1 << PINB2)) <= 0) || ((PINA & (1 << PINA6)) <= 0)) // Trigger Held
+		&& triggerHeld
 		&& (((*millis) - trigger_activeTime) >= RELEASE_DEBOUNCE)) { //checkReleaseDebounce(millis)) {
 
 		trigger_pulled = true;
 		trigger_activeTime = (*millis);
+		pullInterval = ((*millis) - trigger_heldTime > 0xFFFF) ? 0xFFFF : (*millis) - trigger_heldTime;
 		trigger_heldTime = (*millis);  // How long the trigger was held for
-		
-		switch (FIRING_MODE) {
-			case 0: // Full Auto
-				firing_queue = 1;
-				break;
-			case 1: // Burst
-				// Don't allow burst if safety shots have not been reached
-				if (safetyShotsFired >= SAFETY_SHOT || SAFETY_SHOT == 0) {
-					firing_queue = BURST_SIZE;
-				} else {
-					firing_queue = 1;
-				}			
-				break;
-			case 2: // Auto Response
-				firing_queue++;			
-				break;
-			default:  // Single Shot
-				firing_queue = 1;			
-				break;
+		trainer_pull(pullInterval, *millis);
+		pullShotsFired = 0;
+
+		// Whichever switch closed first started the pull, time the other one
+		for (uint8_t i = 0; i < 2; i++) {
+			if (!trigger_switches[i].closed) {
+				trigger_switches[i].lagPending = true;
+			} else {
+				countUp(&trigger_switches[i].health.leads);
+			}
 		}
+
+		runProgram(PROGRAM_PULL, *millis);
 	}
 		
 	//////// TRIGGER HELD
 	// Trigger Held
 	if (trigger_pulled
-		&& (((PINB & (1 << PINB2)) <= 0) || ((PINA & (1 << PINA6)) <= 0)) // Trigger Held
+		&& triggerHeld
 		&& pastPullDebounce // checkPullDebounce(millis)
 		&& (((*millis) - trigger_activeTime) >= ROUND_DELAY)) {
 		
-		switch (FIRING_MODE) {
-			case 0: // Full Auto
-				trigger_activeTime = (*millis);
-		
-				// Don't allow FA if safety shots have not been reached
-				// FA needs to be greater than the safety shot
-				// since holding the trigger would auto-qualify the last safety shot.
-				if (safetyShotsFired > SAFETY_SHOT || SAFETY_SHOT == 0) {
-					firing_queue = 1;
-				}
-				break;
-			case 1:
-				// Nothing while trigger is held
-				break;
-			case 2:
-				// Nothing while trigger is held
-				break;
-			default:
-				// Nothing while trigger is held
-				break;
-		}		
+		runProgram(PROGRAM_HELD, *millis);
 	}
 	
 	//////// TRIGGER RELEASED
 	// Trigger Release
 	if (trigger_pulled
-		&& (((PINB & (1 << PINB2)) > 0) && ((PINA & (1 << PINA6)) > 0)) // triggerReleased()
+		&& !triggerHeld
 		&& pastPullDebounce) { //checkPullDebounce(millis)) {
 
 		trigger_pulled = false;
 		trigger_activeTime = (*millis);
 
-		// Fire a round if Auto response
-		if (FIRING_MODE == 2) {
-
-			// If the trigger was held for 2 seconds or more, don't fire a round
-			if (((*millis) - trigger_heldTime) < 2000) {
-
-				// Don't allow auto response if safety shots have not been reached
-				if (safetyShotsFired >= SAFETY_SHOT || SAFETY_SHOT == 0) {
-					firing_queue++;
-				}
-			}
-		}
+		runProgram(PROGRAM_RELEASE, *millis);
 		
 		// If AMMO LIMIT is enabled and the trigger is held down for more than 2 seconds, reset the ammo limit
 		// For now, I'm leaving this enabled for full-auto as well (we'll see how the user feedback goes).
@@ -150,11 +402,22 @@ void trigger_run(volatile uint32_t *millis) {
 		}		
 	}
 
+	checkSwitchHealth(*millis);
+
 	// FIRE!!!
 	//fireFromQueue(millis);
 
+	// Stale auto response shots are dropped rather than fired late
+	while (programBuffered && firing_queue > 0
+		&& oldestShotAge(*millis) > SHOT_EXPIRY) {
+		takeBufferedShot(*millis);
+	}
 
-	if (firing_queue > 0 && ((*millis) - queue_activeTime >= ROUND_DELAY)) {
+
+	// millis only counts whole ticks.  A shot that left part way through
+	// one, a fresh pull or the first shot after power on, waits one more
+	// tick so the interval after it can't come up short of the cap.
+	if (firing_queue > 0 && ((*millis) - queue_activeTime >= ROUND_DELAY + queue_midTick)) {
 
 		lastTriggerPullTime = (*millis);
 
@@ -167,14 +430,28 @@ void trigger_run(volatile uint32_t *millis) {
 			safetyShotsFired = safetyMax;
 		}
 
+		if (pullShotsFired < 255) {
+			pullShotsFired++;
+		}
+
 		// decrement the queue
-		firing_queue--;
+		if (programBuffered) {
+			takeBufferedShot(*millis);
+		} else {
+			firing_queue--;
+		}
 
 		// Fire a round
 		solenoid_reset();
 
 		// Reset the trigger active time
 		queue_activeTime = (*millis);
+
+		// A shot the cap held back leaves as its tick starts
+		queue_midTick = !queue_capHeld;
+		queue_capHeld = false;
+	} else {
+		queue_capHeld = firing_queue > 0;
 	}
 
 	// If the ball was fired within a second, increment safety shots fired
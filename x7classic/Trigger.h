@@ -18,13 +18,67 @@ along with mad-phenom.  If not, see <http://www.gnu.org/licenses/>.
 #define TRIGGER_H_
 
 #include <avr/io.h>
+#include <avr/eeprom.h>
 #include <stdbool.h>
+#include "Globals.h"
+
+/************************************************************************/
+/* Wear counters for one trigger switch.  They count from power on and  */
+/* are added to EEPROM_SWITCH_HEALTH on power down, the config menu     */
+/* reads the totals out.  The counts stop at the top rather than wrap.  */
+/************************************************************************/
+typedef struct {
+	uint16_t bounces;      // Edges inside the lockout window
+	uint16_t leads;        // Pulls this switch started
+	uint16_t stuckOpen;    // Times the other switch closed and this one never joined
+	uint16_t stuckClosed;  // Times it stayed closed after the other opened
+	uint8_t worstLag;      // Furthest it trailed the other switch on a pull (ms)
+} switch_health;
+
+/************************************************************************/
+/* Each trigger switch is debounced on its own.  An edge is accepted    */
+/* as soon as it happens, further edges within SWITCH_DEBOUNCE count as */
+/* bounce.                                                              */
+/************************************************************************/
+typedef struct {
+	bool raw;              // Last pin state seen
+	bool closed;           // Debounced state
+	bool lagPending;       // The other switch started this pull, waiting for this one
+	bool stuckReported;
+	uint16_t edgeTime;     // Low 16 bits of millis at the last accepted edge
+	uint8_t lastLag;       // How far it trailed the other switch on the last pull (ms)
+	switch_health health;
+} trigger_switch;
+
+extern trigger_switch trigger_switches[2];
+
+// Totals for trigger 1 then trigger 2, erased EEPROM reads as no wear
+extern switch_health EEMEM EEPROM_SWITCH_HEALTH[2];
+
+#ifndef __AVR__
+/************************************************************************/
+/* Auto response shot buffer statistics, simulator only (replay -d),    */
+/* the firmware build leaves them out.  The depth histogram is halved   */
+/* whenever a bin fills, so it keeps its shape rather than flattening   */
+/* out at 255.  The other counters stop at 255.                         */
+/************************************************************************/
+typedef struct {
+	uint8_t depth[MAX_BUFFER_DEPTH + 2]; // Queue depth seen by each pull or release
+	uint8_t dropped;                     // Shots refused because the buffer was full
+	uint8_t expired;                     // Shots dropped for waiting longer than SHOT_EXPIRY
+} buffer_statistics;
+
+extern buffer_statistics buffer_stats;
+#endif
 
 void trigger_run(volatile uint32_t *millisecond);
 //void trigger_changeMode();
 bool triggerHeld();
 bool triggerReleased();
+void trigger_loadHealth(switch_health *health);
+void trigger_saveHealth();
 
 extern bool trigger_pulled;
+extern uint8_t firing_queue;
 
 #endif /* TRIGGER_H_ */
\ No newline at end of file
@@ -0,0 +1,85 @@
+/*
+This file is part of mad-phenom.
+
+mad-phenom is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+mad-phenom is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with mad-phenom.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <avr/io.h>
+#include <avr/wdt.h>
+#include <stdbool.h>
+#include "Watchdog.h"
+#include "Pins.h"
+
+#define WATCHDOG_MAGIC 0x5744
+
+watchdog_record watchdog_stats __attribute__ ((section (".noinit")));
+uint8_t watchdog_resetFlags __attribute__ ((section (".noinit")));
+
+void watchdog_init() __attribute__ ((naked)) __attribute__ ((section (".init3")));
+
+/************************************************************************/
+/* Runs from .init3, right after the stack is set up.  The watchdog     */
+/* stays enabled across a watchdog reset, so it has to be stopped here  */
+/* before the C runtime spends time clearing .bss.  The solenoid is     */
+/* driven low before anything else can happen.                          */
+/************************************************************************/
+void watchdog_init() {
+	PIN_LOW(SOLENOID);
+	PIN_OUTPUT(SOLENOID);
+
+	watchdog_resetFlags = MCUSR;
+	MCUSR = 0;
+	wdt_disable();
+
+	if ((watchdog_resetFlags & (1 << WDRF)) && watchdog_stats.magic == WATCHDOG_MAGIC) {
+		watchdog_stats.resets++;
+	} else {
+		watchdog_stats.magic = WATCHDOG_MAGIC;
+		watchdog_stats.resets = 0;
+		watchdog_stats.overruns = 0;
+		watchdog_stats.worstPass = 0;
+	}
+}
+
+bool watchdog_wasReset() {
+	return (watchdog_resetFlags & (1 << WDRF)) != 0;
+}
+
+void watchdog_arm() {
+	wdt_enable(WDTO_30MS);
+}
+
+void watchdog_disarm() {
+	wdt_disable();
+}
+
+/************************************************************************/
+/* Called at the end of every run loop pass.  The watchdog is only fed  */
+/* when the pass finished within WATCHDOG_DEADLINE.                     */
+/************************************************************************/
+void watchdog_passDone(uint32_t start, uint32_t end) {
+	uint32_t pass = end - start;
+
+	if (pass > watchdog_stats.worstPass) {
+		watchdog_stats.worstPass = (pass > 255) ? 255 : pass;
+	}
+
+	if (pass > WATCHDOG_DEADLINE) {
+		if (watchdog_stats.overruns < 0xFFFF) {
+			watchdog_stats.overruns++;
+		}
+		return;
+	}
+
+	wdt_reset();
+}
@@ -0,0 +1,44 @@
+/*
+This file is part of mad-phenom.
+
+mad-phenom is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+mad-phenom is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with mad-phenom.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef WATCHDOG_H_
+#define WATCHDOG_H_
+
+#include <avr/io.h>
+#include <stdbool.h>
+
+// Time allowed for one pass of the run loop before the watchdog is starved (ms)
+#define WATCHDOG_DEADLINE 4
+
+/************************************************************************/
+/* Kept in .noinit so it survives a watchdog reset.  It is cleared on   */
+/* any other kind of reset.                                             */
+/************************************************************************/
+typedef struct {
+	uint16_t magic;
+	uint16_t resets;    // Watchdog resets since power on
+	uint16_t overruns;  // Loop passes that missed the deadline
+	uint8_t worstPass;  // Longest loop pass seen (ms)
+} watchdog_record;
+
+extern watchdog_record watchdog_stats;
+
+bool watchdog_wasReset();
+void watchdog_arm();
+void watchdog_disarm();
+void watchdog_passDone(uint32_t start, uint32_t end);
+
+#endif /* WATCHDOG_H_ */
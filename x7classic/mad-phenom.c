@@ -25,6 +25,11 @@ along with mad-phenom.  If not, see <http://www.gnu.org/licenses/>.
 #include "Menu.h"
 #include "Trigger.h"
 #include "PushButton.h"
+#include "Pins.h"
+#include "Watchdog.h"
+#include "Battery.h"
+#include "Trainer.h"
+#include "Stack.h"
 
 volatile uint32_t millis = 0;
 uint8_t counter = 0;
@@ -47,91 +52,103 @@ int main(void) {
 	TIMSK0 |= 1 << OCIE0A; // Configure Timer0 for Compare Match
 	OCR0A = 255; // Match at 200
 	
-	sei();  // Enable global interrupts
-	
-	initialize();
-	
-	DDRA |= (1 << PINA1); // Pin 12 - Red LED
-	DDRA |= (1 << PINA2); // Pin 11 - Green LED
-	DDRA |= (1 << PINA7); // Pin 6  - Solenoid
-	
-	DDRB &= ~(1 << PINB1); // Pin 3 - Push button
-	DDRB &= ~(1 << PINB2); // Pin 5 - Trigger Pin 1
-	DDRA &= ~(1 << PINA6); // Pin 7 - Trigger Pin 2
+	// Switches pull to ground, enable the pull-ups first so they have
+	// settled by the time initialize() reads the selector
+	PIN_INPUT_PULLUP(BUTTON);
+	PIN_INPUT_PULLUP(TRIGGER_1);
+	PIN_INPUT_PULLUP(TRIGGER_2);
+	PIN_INPUT_PULLUP(SELECTOR);
+
+	PIN_OUTPUT(LED_RED);
+	PIN_OUTPUT(LED_GREEN);
+	PIN_OUTPUT(SOLENOID);
 
 	// Other unknown pins
 	//DDRA |= (1 << PINA0); // Pin 13
 	//PORTA |= (1 << PINA0); // 13 - HIGH
 
-	DDRA |= (1 << PINA3); // Pin 10 - Power pin
-	PORTA |= (1 << PINA3); // 10 - HIGH
+	PIN_OUTPUT(POWER);
+	PIN_HIGH(POWER);
 	//PORTA &= ~(1 << PINA4);	// 9 - LOW
 	//PORTA &= ~(1 << PINA5);	// 8 - LOW
 	
-	// Set Triggers HIGH
-	PORTB |= (1 << PINB2);
-	PORTA |= (1 << PINA6);
+	sei();  // Enable global interrupts
 	
-	// Set Pushbutton HIGH
-	PORTB |= (1 << PINB1);
+	// Only the current preset is read here, the firing core is running
+	// within a millisecond of reset.  Config mode is decided inside the
+	// run loop, after a watchdog reset the button is ignored.
+	initialize();
 
-	// Selector switch on pin 2
-	DDRB &= ~(1 << PINB0); // Pin 2
-	PORTB |= (1 << PINB0); // Pin 2 set HIGH
-	
-	// If the button is held during startup, enter config mode.
-	uint16_t buttonHeldTime = 0;
-	bool configMode = false;
-	while ((PINB & (1 << PINB1)) <= 0) {
-		delay_ms(1);
-		
-		buttonHeldTime++;
-		if (buttonHeldTime > 3000) {
-			buttonHeldTime = 3000;
-		}
+	if (!watchdog_wasReset()) {
+		pushbutton_boot();
 	}
-	
-	if (buttonHeldTime >= 1000) {
-		configMode = true;
+
+	watchdog_arm();
+
+	for (;;) {
+		uint32_t passStart = millis;
+
+		// This prevents time from changing within an iteration
+		trigger_run(&millis);
+		pushbutton_run(&millis);
+		battery_run(&millis);
+		trainer_run(&millis);
+
+		// If the button is held during startup, enter config mode.
+		if (pushbutton_configRequested(&millis)) {
+			break;
+		}
+
+		// Deepest firing-loop stack use, including any ISR that landed on
+		// it.  Only scanned while nothing is firing, saved on power down.
+		if (pushbutton_poweringDown) {
+			stack_save();
+		} else if (!trigger_pulled && firing_queue == 0) {
+			stack_run(&millis);
+		}
+
+		watchdog_passDone(passStart, millis);
 	}
+
+	watchdog_disarm();
+	solenoidOff();
+	redOff();
+	greenOff();
+
+	// Initialize interrupts for the menu system
+	PCMSK1 |= (1 << PCINT10);  //Enable interrupts on PCINT10 (trigger)
+	PCMSK1 |= (1 << PCINT9);  // Enable interrupts for the push button
+	GIMSK = (1 << PCIE1);    //Enable interrupts period for PCI0 (PCINT11:8
 	
-	if (configMode) {
-		// Initialize interrupts for the menu system
-		PCMSK1 |= (1 << PCINT10);  //Enable interrupts on PCINT10 (trigger)
-		PCMSK1 |= (1 << PCINT9);  // Enable interrupts for the push button
-		GIMSK = (1 << PCIE1);    //Enable interrupts period for PCI0 (PCINT11:8
-		
-		handleConfig();	
-	} else { // Normal run mode
-		for (;;) {
-			// This prevents time from changing within an iteration
-			trigger_run(&millis);
-			pushbutton_run(&millis);
-		}
-	}		
+	handleConfig();
 }
 
 ISR(PCINT1_vect) {
 	uint16_t buttonHeldTime = 0;
 
-	while ((PINB & (1 << PINB1)) <= 0) {
+	while (PIN_CLOSED(BUTTON)) {
 		delay_ms(1);
 
 		buttonHeldTime++;
+		if (buttonHeldTime == 5000) {
+			battery_save();
+			trigger_saveHealth();
+			stack_save();
+		}
 		if (buttonHeldTime > 5000) {
 			// Power down
-			PORTA &= ~(1 << PINA3);
+			PIN_LOW(POWER);
 		}
 	}
 
 	buttonHeldTime = 0;
 
 	if (!triggerPulled
-		&& (((PINB & (1 << PINB2)) <= 0) || ((PINA & (1 << PINA6)) <= 0))) { // Trigger Held
+		&& TRIGGER_HELD()) {
 		triggerPulled = true;
 
 		delay_ms(PULL_DEBOUNCE);
-		while ((((PINB & (1 << PINB2)) <= 0) || ((PINA & (1 << PINA6)) <= 0))) { // Trigger Held
+		while (TRIGGER_HELD()) {
 			delay_ms(1);
 			buttonHeldTime += 1;
 			
@@ -143,7 +160,7 @@ ISR(PCINT1_vect) {
 	}
 
 	if (triggerPulled
-	    && (((PINB & (1 << PINB2)) > 0) && ((PINA & (1 << PINA6)) > 0))) { // && triggerReleased()) {
+	    && TRIGGER_RELEASED()) {
 		delay_ms(RELEASE_DEBOUNCE);
 		triggerPulled = false;
 	}
@@ -0,0 +1,313 @@
+/*
+This file is part of mad-phenom.
+
+mad-phenom is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+mad-phenom is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with mad-phenom.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/************************************************************************/
+/* Plays an upload into the bootloader end to end.  The upload is the   */
+/* push button line as a trace, as written by fwupload.py --trace (or   */
+/* captured off a real uploader with a logic analyzer).  Without one a  */
+/* test image is framed here and sent instead.  The marker is powered   */
+/* on with the button and trigger 1 held, the button is let go and the  */
+/* upload starts at -s.  bootloader_update runs in virtual time against */
+/* the simulated flash, which is then checked against -i.               */
+/*                                                                      */
+/*   -e us  inverts the line for one bit time there (expects BAD_FRAME) */
+/*   -c us  cuts the power there (expects an unfinished update)         */
+/*   -w     cuts the power in every flash erase and write window in     */
+/*          turn.  Each time page 0 must be untouched and the update    */
+/*          unfinished, and uploading again must then complete.         */
+/*                                                                      */
+/* Build from x7classic/:                                               */
+/*   gcc -std=gnu99 -O2 -Isim/host -o bootload sim/bootload.c           */
+/*       sim/trace.c sim/sim.c Bootloader.c Program.c Common.c          */
+/*       Globals.c Trigger.c Solenoid.c PushButton.c Battery.c          */
+/*       Trainer.c                                                      */
+/************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+#include <unistd.h>
+#include "sim.h"
+#include "trace.h"
+#include "../Bootloader.h"
+
+#define BOOTLOAD_START_US 200000  // Upload starts this long after power on
+#define BOOTLOAD_RELEASE_US 100000 // Button let go this long after power on
+#define BOOTLOAD_IDLE_US 1000000  // Silence after the upload before giving up
+#define BOOTLOAD_FRAME_GAP_US 20000 // As fwupload.py, past the page erase and write
+
+static trace upload;
+static uint32_t uploadIndex = 0;
+static uint32_t startTime = BOOTLOAD_START_US;
+static uint32_t errorTime = 0;
+static uint32_t cutTime = 0;
+static uint16_t cutSpm = 0;
+static bool lineLow = false;
+static jmp_buf powerLost;
+static uint8_t image[BOOTLOADER_START];
+static uint8_t vectorPage[SPM_PAGESIZE];
+
+static void driveLine() {
+	if (sim_time >= BOOTLOAD_RELEASE_US && sim_time < startTime) {
+		lineLow = false;
+	}
+
+	while (uploadIndex < upload.count && startTime + upload.events[uploadIndex].time <= sim_time) {
+		if (upload.events[uploadIndex].signal == SIM_BUTTON) {
+			lineLow = upload.events[uploadIndex].closed;
+		}
+		uploadIndex++;
+	}
+
+	bool glitch = errorTime > 0 && sim_time >= errorTime && sim_time < errorTime + BOOTLOADER_BIT_US;
+	sim_setInput(SIM_BUTTON, lineLow != glitch);
+
+	// sim_spmCount moves on as an erase or write starts, this is its wait
+	if ((cutTime > 0 && sim_time >= cutTime) || (cutSpm > 0 && sim_spmCount == cutSpm) ||
+		sim_time > startTime + upload.end + BOOTLOAD_IDLE_US) {
+		longjmp(powerLost, 1);
+	}
+}
+
+/************************************************************************/
+/* Page 0 as a programmer leaves it, see bootloader_vectors             */
+/************************************************************************/
+static void makeVectorPage() {
+	memset(vectorPage, 0xFF, SPM_PAGESIZE);
+	for (uint8_t i = 0; i < _VECTORS_SIZE; i += 2) {
+		uint16_t target = i == 0 ? BOOTLOADER_START : BOOTLOADER_APP_VECTORS + i;
+		vectorPage[i] = BOOTLOADER_RJMP(i, target) & 0xFF;
+		vectorPage[i + 1] = BOOTLOADER_RJMP(i, target) >> 8;
+	}
+}
+
+static void oldApplication() {
+	for (uint16_t i = 0; i <= FLASHEND; i++) {
+		sim_flash[i] = (i * 7) ^ 0x5A;
+	}
+	memcpy(sim_flash, vectorPage, SPM_PAGESIZE);
+}
+
+static uint16_t crc16(uint16_t crc, uint8_t data) {
+	// As the bootloader and fwupload.py
+	crc ^= (uint16_t) data << 8;
+	for (uint8_t i = 0; i < 8; i++) {
+		crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+	}
+	return crc;
+}
+
+static void sendByte(uint32_t *time, uint8_t data) {
+	// Start bit, 8 data bits LSB first, stop bit
+	uint16_t bits = (1 << 9) | ((uint16_t) data << 1);
+	for (uint8_t i = 0; i < 10; i++) {
+		bool low = !(bits & (1 << i));
+		if (low != lineLow) {
+			trace_add(&upload, *time, SIM_BUTTON, low);
+			lineLow = low;
+		}
+		*time += BOOTLOADER_BIT_US;
+	}
+}
+
+/************************************************************************/
+/* A pattern image with an rjmp in the entry slot, framed as            */
+/* fwupload.py would send it                                            */
+/************************************************************************/
+static void testUpload() {
+	memcpy(image, vectorPage, SPM_PAGESIZE);
+	for (uint16_t i = SPM_PAGESIZE; i < BOOTLOADER_START; i++) {
+		image[i] = (i * 13 + (i >> 8)) ^ 0xA7;
+	}
+	uint16_t entry = BOOTLOADER_RJMP(BOOTLOADER_APP_ENTRY, BOOTLOADER_APP_VECTORS + _VECTORS_SIZE);
+	image[BOOTLOADER_APP_ENTRY] = entry & 0xFF;
+	image[BOOTLOADER_APP_ENTRY + 1] = entry >> 8;
+
+	uint32_t time = 0;
+	lineLow = false;
+	for (uint8_t index = 1; index <= BOOTLOADER_ENTRY_PAGE; index++) {
+		uint16_t crc = crc16(crc16(0xFFFF, FRAME_PAGE), index);
+		sendByte(&time, FRAME_PAGE);
+		sendByte(&time, index);
+		for (uint8_t i = 0; i < SPM_PAGESIZE; i++) {
+			uint8_t data = image[index * SPM_PAGESIZE + i];
+			crc = crc16(crc, data);
+			sendByte(&time, data);
+		}
+		sendByte(&time, crc >> 8);
+		sendByte(&time, crc & 0xFF);
+		time += BOOTLOAD_FRAME_GAP_US;
+	}
+	upload.end = time;
+}
+
+/************************************************************************/
+/* One power on with the switches held, through to the end of the       */
+/* upload or the power cut                                              */
+/************************************************************************/
+static const char *play() {
+	sim_time = 0;
+	uploadIndex = 0;
+	sim_setInput(SIM_TRIGGER_1, true);
+	sim_setInput(SIM_TRIGGER_2, false);
+	sim_setInput(SIM_SELECTOR, false);
+	sim_setInput(SIM_BUTTON, true);
+	lineLow = true;
+	sim_delayHook = driveLine;
+
+	const char *outcome;
+	if (setjmp(powerLost) == 0) {
+		uint8_t result = bootloader_update();
+		outcome = result == BOOTLOADER_OK ? "ok" : "bad frame";
+	} else {
+		outcome = (cutTime > 0 && sim_time >= cutTime) || cutSpm > 0 ? "power cut" : "upload stopped";
+	}
+	sim_delayHook = 0;
+	return outcome;
+}
+
+static uint16_t differences() {
+	uint16_t count = 0;
+	for (uint16_t i = 0; i < BOOTLOADER_START; i++) {
+		if (sim_flash[i] != image[i]) {
+			count++;
+		}
+	}
+	return count;
+}
+
+/************************************************************************/
+/* Power cut in each erase and write window of a clean upload           */
+/************************************************************************/
+static int cutEveryWindow() {
+	oldApplication();
+	sim_spmCount = 0;
+	if (strcmp(play(), "ok") != 0) {
+		printf("clean upload failed\n");
+		return 1;
+	}
+	uint16_t windows = sim_spmCount;
+
+	int status = 0;
+	for (cutSpm = 1; cutSpm <= windows; cutSpm++) {
+		oldApplication();
+		sim_spmCount = 0;
+		const char *outcome = play();
+		bool vectorsKept = memcmp(sim_flash, vectorPage, SPM_PAGESIZE) == 0;
+		bool unfinished = !BOOTLOADER_APP_COMPLETE();
+
+		// The next power on stays in the bootloader, which takes the upload again
+		uint16_t saved = cutSpm;
+		cutSpm = 0;
+		const char *retry = play();
+		cutSpm = saved;
+
+		if (strcmp(outcome, "power cut") != 0 || !vectorsKept || !unfinished ||
+			strcmp(retry, "ok") != 0 || differences() > 0) {
+			printf("cut in window %u of %u: %s, page 0 %s, application %s, upload again %s\n",
+				cutSpm, windows, outcome, vectorsKept ? "kept" : "CHANGED",
+				unfinished ? "unfinished" : "COMPLETE", retry);
+			status = 1;
+		}
+	}
+
+	printf("power cut in each of %u erase and write windows: %s\n", windows, status ? "FAILED" : "ok");
+	return status;
+}
+
+static void usage() {
+	fprintf(stderr,
+		"usage: bootload [options] [upload.txt]\n"
+		"  -i file      expected image below the bootloader, raw binary (fwupload.py --bin)\n"
+		"  -s us        upload start after power on (default %u)\n"
+		"  -e us        invert the line for one bit at this time\n"
+		"  -c us        cut the power at this time\n"
+		"  -w           cut the power in every erase and write window in turn\n"
+		"Without an upload a test image is sent, and is also the expected image.\n",
+		BOOTLOAD_START_US);
+	exit(2);
+}
+
+int main(int argc, char **argv) {
+	const char *imagePath = 0;
+	bool everyWindow = false;
+
+	int option;
+	while ((option = getopt(argc, argv, "i:s:e:c:w")) != -1) {
+		switch (option) {
+			case 'i': imagePath = optarg; break;
+			case 's': startTime = atoi(optarg); break;
+			case 'e': errorTime = atoi(optarg); break;
+			case 'c': cutTime = atoi(optarg); break;
+			case 'w': everyWindow = true; break;
+			default: usage();
+		}
+	}
+
+	if (optind < argc - 1 || startTime <= BOOTLOAD_RELEASE_US) {
+		usage();
+	}
+
+	makeVectorPage();
+	trace_init(&upload);
+	if (optind == argc) {
+		testUpload();
+	} else if (!trace_load(argv[optind], &upload)) {
+		return 1;
+	}
+
+	if (imagePath) {
+		FILE *file = fopen(imagePath, "rb");
+		if (!file || fread(image, 1, sizeof(image), file) != sizeof(image)) {
+			fprintf(stderr, "bootload: %s is not a %u byte image\n", imagePath, BOOTLOADER_START);
+			return 1;
+		}
+		fclose(file);
+	}
+	bool checkImage = imagePath || optind == argc;
+
+	if (everyWindow) {
+		int status = cutEveryWindow();
+		trace_free(&upload);
+		return status;
+	}
+
+	// An old application in place, with the switches held at power on
+	oldApplication();
+	const char *outcome = play();
+	int status = 0;
+
+	printf("result: %s after %.1f ms\n", outcome, sim_time / 1000.0);
+	printf("application: %s\n", BOOTLOADER_APP_COMPLETE() ? "complete" : "unfinished, bootloader at next reset");
+
+	if (memcmp(sim_flash, vectorPage, SPM_PAGESIZE) != 0) {
+		printf("page 0: changed, reset vector %04x\n", sim_flash[0] | (sim_flash[1] << 8));
+		status = 1;
+	}
+
+	if (checkImage) {
+		uint16_t count = differences();
+		printf("image: %u byte(s) differ\n", count);
+
+		if (count > 0 && strcmp(outcome, "ok") == 0) {
+			status = 1;
+		}
+	}
+
+	trace_free(&upload);
+	return status;
+}
@@ -0,0 +1,158 @@
+/*
+This file is part of mad-phenom.
+
+mad-phenom is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+mad-phenom is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with mad-phenom.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/************************************************************************/
+/* Cold start benchmark.  Each scenario powers the simulated marker on  */
+/* from cold globals and reports, in virtual time after reset:          */
+/*                                                                      */
+/*   ready  - when the first main loop pass runs                        */
+/*   shot   - when the first shot leaves                                */
+/*   config - when the main loop gave way to config mode                */
+/*                                                                      */
+/* Busy waits in the boot path advance the virtual clock, so anything   */
+/* that holds up the firing core before the run loop shows up in ready. */
+/* So do EEPROM reads, at SIM_EEPROM_READ_CYCLES a byte.  The C runtime */
+/* start up is not timed.                                               */
+/*                                                                      */
+/* Build from x7classic/:                                               */
+/*   gcc -std=gnu99 -O2 -Isim/host -o boottime sim/boottime.c sim/sim.c */
+/*       Program.c Common.c Globals.c Trigger.c Solenoid.c PushButton.c */
+/*       Battery.c Trainer.c                                            */
+/************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "sim.h"
+#include "../Globals.h"
+
+#define BOOT_RUN_US 2000000
+
+typedef struct {
+	const char *name;
+	uint8_t closedAtPowerOn;
+	uint32_t buttonRelease; // us, 0 leaves the button alone
+	uint32_t pull;          // us of a clean trigger pull, 0 for none
+} boot_scenario;
+
+typedef struct {
+	uint32_t ready;
+	uint32_t shot;
+	uint32_t config;
+	uint8_t selector;
+} boot_result;
+
+static const boot_scenario scenarios[] = {
+	{"pull at 2ms",           0,                                       0,       2000},
+	{"trigger held",          1 << SIM_TRIGGER_1,                      0,       0},
+	{"button tapped 300ms",   1 << SIM_BUTTON,                         300000,  50000},
+	{"button held (config)",  1 << SIM_BUTTON,                         0,       50000},
+	{"selector FA, pull 2ms", 1 << SIM_SELECTOR,                       0,       2000},
+};
+
+#define BOOT_SCENARIOS (sizeof(scenarios) / sizeof(scenarios[0]))
+
+typedef struct {
+	sim_config config;
+	const boot_scenario *scenario;
+} boot_run;
+
+static void runScenario(void *arg, void *result) {
+	const boot_run *run = arg;
+	boot_result *out = result;
+
+	sim_init(&run->config);
+	out->ready = sim_readyTime;
+	out->selector = currentSelector;
+
+	if (run->scenario->closedAtPowerOn & (1 << SIM_TRIGGER_1)) {
+		sim_runUntil(100000);
+		sim_setInput(SIM_TRIGGER_1, false);
+	}
+
+	if (run->scenario->pull > 0 && (run->scenario->buttonRelease == 0 || run->scenario->pull < run->scenario->buttonRelease)) {
+		sim_runUntil(run->scenario->pull);
+		sim_setInput(SIM_TRIGGER_1, true);
+		sim_runUntil(run->scenario->pull + 30000);
+		sim_setInput(SIM_TRIGGER_1, false);
+	}
+
+	if (run->scenario->buttonRelease > 0) {
+		sim_runUntil(run->scenario->buttonRelease);
+		sim_setInput(SIM_BUTTON, false);
+	}
+
+	sim_runUntil(BOOT_RUN_US);
+
+	out->shot = sim_shotCount > 0 ? sim_shots[0].onTime : 0;
+	out->config = sim_configTime;
+}
+
+static void usage() {
+	fprintf(stderr,
+		"usage: boottime [options]\n"
+		"  -b bps       balls per second (5-40, default 20)\n"
+		"  -p us        main loop pass time (default 25)\n");
+	exit(2);
+}
+
+static void printTime(uint32_t us) {
+	if (us == 0) {
+		printf(" %8s", "-");
+	} else {
+		printf(" %8.3f", us / 1000.0);
+	}
+}
+
+int main(int argc, char **argv) {
+	boot_run run;
+	sim_defaultConfig(&run.config);
+
+	int option;
+	while ((option = getopt(argc, argv, "b:p:")) != -1) {
+		switch (option) {
+			case 'b': run.config.ballsPerSecond = atoi(optarg); break;
+			case 'p': run.config.passTime = atoi(optarg); break;
+			default: usage();
+		}
+	}
+
+	printf("# mode: 0 full auto, 1 burst, 2 auto response, 3 semi\n");
+	printf("# times in ms after reset, - if it never happened\n");
+	printf("# mode scenario                  ready     shot   config selector\n");
+
+	for (uint8_t mode = 0; mode < 4; mode++) {
+		for (uint8_t i = 0; i < BOOT_SCENARIOS; i++) {
+			boot_result result;
+
+			run.config.firingMode = mode;
+			run.config.closedAtPowerOn = scenarios[i].closedAtPowerOn;
+			run.scenario = &scenarios[i];
+
+			if (!sim_isolated(runScenario, &run, &result, sizeof(result))) {
+				fprintf(stderr, "boottime: mode %u %s failed\n", mode, scenarios[i].name);
+				return 1;
+			}
+
+			printf("%6u %-22s %8.3f", mode, scenarios[i].name, result.ready / 1000.0);
+			printTime(result.shot);
+			printTime(result.config);
+			printf(" %8u\n", result.selector);
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,69 @@
+#!/bin/sh
+#
+# This file is part of mad-phenom.
+#
+# mad-phenom is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# mad-phenom is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with mad-phenom.  If not, see <http://www.gnu.org/licenses/>.
+#
+# Replays every trace in sim/traces through the simulated firing core
+# and compares the shot timelines against sim/golden.  Any change in
+# shot count, cadence, dwell or latency fails the run, so a firmware
+# change that should not touch shot timing can be proven not to.
+#
+# Each trace names its replay options on a "# replay:" line.
+#
+# The fuzz corpus in sim/corpus is measured again with fuzz -c, every
+# file has to give the metrics recorded on its "# fuzz:" line.
+#
+# The bootloader takes a test upload with the power cut in each of its
+# flash erase and write windows, see sim/bootload.c.
+#
+# usage: sim/check.sh [-u]   (from x7classic/, -u rewrites the goldens)
+
+cd "$(dirname "$0")/.." || exit 2
+
+BUILD=${BUILD:-/tmp/x7classic-sim}
+FIRMWARE="Program.c Common.c Globals.c Trigger.c Solenoid.c PushButton.c Battery.c Trainer.c"
+mkdir -p "$BUILD"
+
+gcc -std=gnu99 -O2 -Wall -Isim/host -o "$BUILD/replay" sim/replay.c sim/sim.c sim/trace.c \
+	sim/timeline.c $FIRMWARE || exit 2
+gcc -std=gnu99 -O2 -Wall -Isim/host -o "$BUILD/fuzz" sim/fuzz.c sim/sim.c sim/trace.c \
+	$FIRMWARE || exit 2
+gcc -std=gnu99 -O2 -Wall -Isim/host -o "$BUILD/bootload" sim/bootload.c sim/sim.c sim/trace.c \
+	Bootloader.c $FIRMWARE || exit 2
+
+failed=0
+for input in sim/traces/*.txt; do
+	name=$(basename "$input" .txt)
+	golden=sim/golden/$name.txt
+	options=$(sed -n 's/^# replay://p' "$input")
+
+	if [ "$1" = "-u" ]; then
+		"$BUILD/replay" $options -o "$golden" "$input" || exit 2
+		echo "updated $golden"
+	elif "$BUILD/replay" $options -g "$golden" "$input" > /dev/null; then
+		echo "ok      $name"
+	else
+		echo "FAILED  $name"
+		failed=1
+	fi
+done
+
+# The corpus is rewritten by running fuzz -o sim/corpus, not by -u
+if [ "$1" != "-u" ]; then
+	"$BUILD/fuzz" -c sim/corpus/*.txt || failed=1
+	"$BUILD/bootload" -w || failed=1
+fi
+
+exit $failed
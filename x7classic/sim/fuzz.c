@@ -0,0 +1,457 @@
+/*
+This file is part of mad-phenom.
+
+mad-phenom is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+mad-phenom is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with mad-phenom.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/************************************************************************/
+/* Adversarial input search around the firing core.                     */
+/*                                                                      */
+/* Trigger, button and selector edge sequences (with contact bounce,    */
+/* lagging second switch, preset toggles and selector flips) are        */
+/* generated and then mutated by hill climbing towards the worst:       */
+/*                                                                      */
+/*   latency   - longest time from a clean pull to its first shot       */
+/*   interval  - shortest time between two shots                        */
+/*   release   - latest shot after the trigger was finally released     */
+/*                                                                      */
+/* The worst input for each firing mode and objective is written to the */
+/* corpus directory as a text trace that replay can run again.  A       */
+/* "# fuzz:" line at the end of it records the settings and metrics,    */
+/* fuzz -c measures the trace again and checks they still hold.         */
+/* sim/check.sh does that for sim/corpus.                               */
+/*                                                                      */
+/* Build from x7classic/:                                               */
+/*   gcc -std=gnu99 -O2 -Isim/host -o fuzz sim/fuzz.c sim/sim.c         */
+/*       sim/trace.c Program.c Common.c Globals.c Trigger.c Solenoid.c  */
+/*       PushButton.c Battery.c Trainer.c                               */
+/************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "sim.h"
+#include "trace.h"
+#include "../Globals.h"
+
+#define FUZZ_LENGTH_US 1500000
+#define FUZZ_TAIL_US   1000000
+#define FUZZ_CLEAN_US  30000 // A pull is clean when open and closed at least this long
+#define FUZZ_MAX_EVENTS 400
+
+#define OBJECTIVE_LATENCY  0
+#define OBJECTIVE_INTERVAL 1
+#define OBJECTIVE_RELEASE  2
+#define OBJECTIVES         3
+
+typedef struct {
+	uint32_t latency;  // us, worst clean pull to first shot
+	uint32_t interval; // us, shortest shot to shot
+	uint32_t release;  // us, last shot after the final release
+	uint16_t shots;
+} fuzz_metrics;
+
+typedef struct {
+	const sim_config *config;
+	const trace *input;
+} fuzz_run;
+
+static const char *objectiveNames[OBJECTIVES] = {"latency", "interval", "release"};
+
+static uint32_t randomBelow(uint32_t limit) {
+	return limit ? (uint32_t)(random() % limit) : 0;
+}
+
+static bool triggerClosedAt(const trace *t, uint32_t index, bool *closed) {
+	if (t->events[index].signal == SIM_TRIGGER_1) {
+		closed[0] = t->events[index].closed;
+	} else if (t->events[index].signal == SIM_TRIGGER_2) {
+		closed[1] = t->events[index].closed;
+	}
+
+	return closed[0] || closed[1];
+}
+
+static void measure(const trace *t, fuzz_metrics *out) {
+	bool closed[2] = {false, false};
+	bool held = false;
+	uint32_t edges[FUZZ_MAX_EVENTS + 1];
+	bool closing[FUZZ_MAX_EVENTS + 1];
+	uint16_t edgeCount = 0;
+
+	// Edges of the combined trigger (either switch closed)
+	for (uint32_t i = 0; i < t->count; i++) {
+		bool now = triggerClosedAt(t, i, closed);
+
+		if (now != held && edgeCount < FUZZ_MAX_EVENTS) {
+			edges[edgeCount] = t->events[i].time;
+			closing[edgeCount] = now;
+			edgeCount++;
+			held = now;
+		}
+	}
+
+	out->shots = sim_shotCount;
+	out->latency = 0;
+	out->interval = UINT32_MAX;
+	out->release = 0;
+
+	for (uint16_t i = 1; i < sim_shotCount; i++) {
+		uint32_t interval = sim_shots[i].onTime - sim_shots[i - 1].onTime;
+		if (interval < out->interval) {
+			out->interval = interval;
+		}
+	}
+
+	for (uint16_t e = 0; e < edgeCount; e++) {
+		if (!closing[e]) {
+			continue;
+		}
+
+		uint32_t openFor = (e == 0) ? edges[e] : edges[e] - edges[e - 1];
+		uint32_t closedUntil = (e + 1 < edgeCount) ? edges[e + 1] : t->end + FUZZ_TAIL_US;
+		uint32_t nextPull = (e + 2 < edgeCount) ? edges[e + 2] : t->end + FUZZ_TAIL_US;
+
+		if (openFor < FUZZ_CLEAN_US || closedUntil - edges[e] < FUZZ_CLEAN_US) {
+			continue;
+		}
+
+		// A clean pull that never fires counts as lagging until the next pull
+		uint32_t latency = nextPull - edges[e];
+		for (uint16_t s = 0; s < sim_shotCount; s++) {
+			if (sim_shots[s].onTime >= edges[e] && sim_shots[s].onTime < nextPull) {
+				latency = sim_shots[s].onTime - edges[e];
+				break;
+			}
+		}
+
+		if (latency > out->latency) {
+			out->latency = latency;
+		}
+	}
+
+	if (edgeCount > 0 && !closing[edgeCount - 1]) {
+		uint32_t released = edges[edgeCount - 1];
+
+		for (uint16_t s = 0; s < sim_shotCount; s++) {
+			if (sim_shots[s].onTime > released && sim_shots[s].onTime - released > out->release) {
+				out->release = sim_shots[s].onTime - released;
+			}
+		}
+	}
+}
+
+static void runInput(void *arg, void *result) {
+	const fuzz_run *run = arg;
+
+	sim_init(run->config);
+	sim_alternatePresets(run->config);
+	trace_play(run->input, FUZZ_TAIL_US);
+	measure(run->input, result);
+}
+
+static uint32_t score(const fuzz_metrics *metrics, uint8_t objective) {
+	switch (objective) {
+		case OBJECTIVE_LATENCY:  return metrics->latency;
+		case OBJECTIVE_INTERVAL: return UINT32_MAX - metrics->interval;
+		default:                 return metrics->release;
+	}
+}
+
+/************************************************************************/
+/* Input generation and mutation                                        */
+/************************************************************************/
+static void addBounce(trace *t, uint8_t signal, uint32_t time, bool closed) {
+	uint8_t bounces = randomBelow(4);
+
+	for (uint8_t i = 0; i < bounces; i++) {
+		trace_add(t, time, signal, !closed);
+		time += 50 + randomBelow(1500);
+		trace_add(t, time, signal, closed);
+		time += 50 + randomBelow(1500);
+	}
+	trace_add(t, time, signal, closed);
+}
+
+static void addPull(trace *t, uint32_t time) {
+	uint32_t hold = 5000 + randomBelow(randomBelow(2) ? 60000 : 400000);
+	uint32_t lag = randomBelow(3000);
+
+	addBounce(t, SIM_TRIGGER_1, time, true);
+	addBounce(t, SIM_TRIGGER_2, time + lag, true);
+	addBounce(t, SIM_TRIGGER_1, time + hold, false);
+	addBounce(t, SIM_TRIGGER_2, time + hold + randomBelow(3000), false);
+}
+
+static void addGlitch(trace *t, uint32_t time) {
+	uint8_t signal = randomBelow(2) ? SIM_SELECTOR : SIM_BUTTON;
+	uint32_t width = randomBelow(2) ? randomBelow(5000) : randomBelow(300000);
+
+	addBounce(t, signal, time, true);
+	addBounce(t, signal, time + width, false);
+}
+
+static void generate(trace *t) {
+	uint32_t time = randomBelow(50000);
+
+	t->count = 0;
+	t->end = FUZZ_LENGTH_US;
+
+	while (time < FUZZ_LENGTH_US && t->count < FUZZ_MAX_EVENTS - 40) {
+		if (randomBelow(6) == 0) {
+			addGlitch(t, time);
+		} else {
+			addPull(t, time);
+		}
+		time += 20000 + randomBelow(150000);
+	}
+
+	// Pulls overlap, what is run and saved has to be in time order
+	trace_sort(t);
+}
+
+static void mutate(trace *t) {
+	uint32_t pick = randomBelow(t->count);
+	uint32_t time = t->count ? t->events[pick].time : 0;
+
+	switch (randomBelow(5)) {
+		case 0: // Nudge an edge
+			if (t->count) {
+				int32_t shift = (int32_t)randomBelow(20000) - 10000;
+				t->events[pick].time = (shift < 0 && (uint32_t)-shift > time) ? 0 : time + shift;
+			}
+			break;
+		case 1: // Drop an edge
+			if (t->count) {
+				memmove(&t->events[pick], &t->events[pick + 1], (t->count - pick - 1) * sizeof(trace_event));
+				t->count--;
+			}
+			break;
+		case 2: // Bounce around an edge
+			if (t->count && t->count < FUZZ_MAX_EVENTS - 8) {
+				addBounce(t, t->events[pick].signal, time + 100, t->events[pick].closed);
+			}
+			break;
+		case 3:
+			if (t->count < FUZZ_MAX_EVENTS - 20) {
+				addPull(t, randomBelow(FUZZ_LENGTH_US));
+			}
+			break;
+		default:
+			if (t->count < FUZZ_MAX_EVENTS - 20) {
+				addGlitch(t, randomBelow(FUZZ_LENGTH_US));
+			}
+			break;
+	}
+
+	trace_sort(t);
+}
+
+static void copyTrace(trace *to, const trace *from) {
+	to->count = 0;
+	for (uint32_t i = 0; i < from->count; i++) {
+		trace_add(to, from->events[i].time, from->events[i].signal, from->events[i].closed);
+	}
+	to->end = from->end;
+}
+
+static bool evaluate(const sim_config *config, const trace *input, fuzz_metrics *metrics) {
+	fuzz_run run = {config, input};
+
+	return sim_isolated(runInput, &run, metrics, sizeof(fuzz_metrics));
+}
+
+/************************************************************************/
+/* Corpus files.  The metrics go after the events so trace_load, which  */
+/* skips comments, reads the file like any other trace.                 */
+/************************************************************************/
+static bool saveWorst(const char *path, const sim_config *config, const trace *t, const fuzz_metrics *metrics) {
+	if (!trace_save(path, t)) {
+		return false;
+	}
+
+	FILE *f = fopen(path, "a");
+	if (!f) {
+		perror(path);
+		return false;
+	}
+
+	fprintf(f, "# fuzz: -m %u -b %u latency %lu interval %lu release %lu shots %u\n",
+		config->firingMode, config->ballsPerSecond, (unsigned long)metrics->latency,
+		(unsigned long)metrics->interval, (unsigned long)metrics->release, metrics->shots);
+
+	fclose(f);
+	return true;
+}
+
+static bool checkWorst(const char *path) {
+	FILE *f = fopen(path, "r");
+	if (!f) {
+		perror(path);
+		return false;
+	}
+
+	char line[128];
+	unsigned mode = 0, bps = 0, shots = 0;
+	unsigned long latency = 0, interval = 0, release = 0;
+	int fields = 0;
+
+	while (fields != 6 && fgets(line, sizeof(line), f)) {
+		fields = sscanf(line, "# fuzz: -m %u -b %u latency %lu interval %lu release %lu shots %u",
+			&mode, &bps, &latency, &interval, &release, &shots);
+	}
+	fclose(f);
+
+	if (fields != 6) {
+		fprintf(stderr, "%s: no \"# fuzz:\" line\n", path);
+		return false;
+	}
+
+	sim_config config;
+	trace input;
+	fuzz_metrics metrics;
+
+	sim_defaultConfig(&config);
+	config.firingMode = mode;
+	config.ballsPerSecond = bps;
+	trace_init(&input);
+
+	bool ok = trace_load(path, &input) && evaluate(&config, &input, &metrics)
+		&& metrics.latency == latency && metrics.interval == interval
+		&& metrics.release == release && metrics.shots == shots;
+
+	if (!ok) {
+		fprintf(stderr, "%s: recorded latency %lu interval %lu release %lu shots %u\n",
+			path, latency, interval, release, shots);
+		fprintf(stderr, "%s: measured latency %lu interval %lu release %lu shots %u\n",
+			path, (unsigned long)metrics.latency, (unsigned long)metrics.interval,
+			(unsigned long)metrics.release, metrics.shots);
+	}
+
+	trace_free(&input);
+	return ok;
+}
+
+static void usage() {
+	fprintf(stderr,
+		"usage: fuzz [options]\n"
+		"  -m mode      firing mode to search (default: all of 0-3)\n"
+		"  -b bps       balls per second (default 20)\n"
+		"  -n count     evaluations per mode and objective (default 2000)\n"
+		"  -r seed      random seed (default 1)\n"
+		"  -o dir       corpus directory for the worst inputs (default corpus)\n"
+		"  -c           check the corpus files given as arguments instead\n");
+	exit(2);
+}
+
+int main(int argc, char **argv) {
+	sim_config config;
+	const char *corpus = "corpus";
+	uint32_t evaluations = 2000;
+	int firstMode = 0;
+	int lastMode = 3;
+	bool check = false;
+	int option;
+
+	sim_defaultConfig(&config);
+	srandom(1);
+
+	while ((option = getopt(argc, argv, "m:b:n:r:o:c")) != -1) {
+		switch (option) {
+			case 'm': firstMode = lastMode = atoi(optarg); break;
+			case 'b': config.ballsPerSecond = atoi(optarg); break;
+			case 'n': evaluations = strtoul(optarg, NULL, 10); break;
+			case 'r': srandom(strtoul(optarg, NULL, 10)); break;
+			case 'o': corpus = optarg; break;
+			case 'c': check = true; break;
+			default: usage();
+		}
+	}
+
+	if (check) {
+		int failed = 0;
+
+		if (optind >= argc) {
+			usage();
+		}
+
+		for (int i = optind; i < argc; i++) {
+			bool ok = checkWorst(argv[i]);
+
+			printf("%s %s\n", ok ? "ok     " : "FAILED ", argv[i]);
+			failed |= !ok;
+		}
+
+		return failed;
+	}
+
+	mkdir(corpus, 0777);
+
+	// Preset 2 runs at 40 bps, nothing may ever fire faster than that
+	uint32_t cap = 1000000 / 40;
+	printf("# %u bps, alternate presets (replay -x), tightest cap %lu us, %lu evaluations per search\n",
+		config.ballsPerSecond, (unsigned long)cap, (unsigned long)evaluations);
+	printf("mode objective    latency_us  interval_us  release_us  shots\n");
+
+	for (int mode = firstMode; mode <= lastMode; mode++) {
+		config.firingMode = mode;
+
+		for (uint8_t objective = 0; objective < OBJECTIVES; objective++) {
+			trace best, candidate;
+			fuzz_metrics bestMetrics, metrics;
+
+			trace_init(&best);
+			trace_init(&candidate);
+			generate(&best);
+			if (!evaluate(&config, &best, &bestMetrics)) {
+				fprintf(stderr, "fuzz: run failed\n");
+				return 1;
+			}
+
+			for (uint32_t i = 1; i < evaluations; i++) {
+				// Mostly climb from the worst so far, sometimes restart
+				if (randomBelow(10) == 0) {
+					trace_free(&candidate);
+					generate(&candidate);
+				} else {
+					copyTrace(&candidate, &best);
+					for (uint8_t m = 1 + randomBelow(3); m > 0; m--) {
+						mutate(&candidate);
+					}
+				}
+
+				if (evaluate(&config, &candidate, &metrics)
+					&& score(&metrics, objective) > score(&bestMetrics, objective)) {
+					copyTrace(&best, &candidate);
+					bestMetrics = metrics;
+				}
+			}
+
+			char path[512];
+			snprintf(path, sizeof(path), "%s/mode%d-%s.txt", corpus, mode, objectiveNames[objective]);
+			saveWorst(path, &config, &best, &bestMetrics);
+
+			printf("%4d %-10s %12lu %12lu %11lu %6u%s\n", mode, objectiveNames[objective],
+				(unsigned long)bestMetrics.latency,
+				bestMetrics.interval == UINT32_MAX ? 0UL : (unsigned long)bestMetrics.interval,
+				(unsigned long)bestMetrics.release, bestMetrics.shots,
+				(objective == OBJECTIVE_INTERVAL && bestMetrics.interval < cap) ? "  UNDER CAP" : "");
+
+			trace_free(&best);
+			trace_free(&candidate);
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,32 @@
+/*
+This file is part of mad-phenom.
+
+mad-phenom is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+mad-phenom is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with mad-phenom.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef SIM_AVR_BOOT_H_
+#define SIM_AVR_BOOT_H_
+
+// Self-programming goes to the simulator's flash image (sim_flash in
+// sim.c).  Erase and write take their datasheet time in virtual time,
+// and like the real part a write can only clear bits that erase set.
+
+#include <stdint.h>
+
+void boot_page_erase(uint16_t address);
+void boot_page_fill(uint16_t address, uint16_t data);
+void boot_page_write(uint16_t address);
+
+#define boot_spm_busy_wait()
+
+#endif /* SIM_AVR_BOOT_H_ */
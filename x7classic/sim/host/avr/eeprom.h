@@ -0,0 +1,56 @@
+/*
+This file is part of mad-phenom.
+
+mad-phenom is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+mad-phenom is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with mad-phenom.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef SIM_AVR_EEPROM_H_
+#define SIM_AVR_EEPROM_H_
+
+// EEMEM variables are ordinary RAM on the host, so the simulator can
+// preload presets by assigning to them before calling initialize().
+// Reads cost virtual time, see sim_eepromRead() in sim.c.
+
+#include <stdint.h>
+#include <string.h>
+
+#define EEMEM
+
+void sim_eepromRead(size_t size);
+
+static inline uint8_t eeprom_read_byte(const uint8_t *address) {
+	sim_eepromRead(1);
+	return *address;
+}
+
+static inline void eeprom_write_byte(uint8_t *address, uint8_t value) {
+	*address = value;
+}
+
+static inline void eeprom_update_byte(uint8_t *address, uint8_t value) {
+	*address = value;
+}
+
+static inline void eeprom_read_block(void *destination, const void *source, size_t size) {
+	sim_eepromRead(size);
+	memcpy(destination, source, size);
+}
+
+static inline void eeprom_update_block(const void *source, void *destination, size_t size) {
+	memcpy(destination, source, size);
+}
+
+// Host writes complete immediately
+#define eeprom_is_ready() 1
+
+#endif /* SIM_AVR_EEPROM_H_ */
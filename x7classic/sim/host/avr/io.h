@@ -0,0 +1,68 @@
+/*
+This file is part of mad-phenom.
+
+mad-phenom is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+mad-phenom is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with mad-phenom.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef SIM_AVR_IO_H_
+#define SIM_AVR_IO_H_
+
+/************************************************************************/
+/* Host stand-in for <avr/io.h>.  The ATtiny44A I/O registers become    */
+/* plain globals that the simulator drives (PINx) and samples (PORTx).  */
+/************************************************************************/
+
+#include <stdint.h>
+
+extern volatile uint8_t PINA;
+extern volatile uint8_t PINB;
+extern volatile uint8_t PORTA;
+extern volatile uint8_t PORTB;
+extern volatile uint8_t DDRA;
+extern volatile uint8_t DDRB;
+
+extern volatile uint8_t TCCR0B;
+extern volatile uint8_t TIMSK0;
+extern volatile uint8_t OCR0A;
+extern volatile uint8_t TCNT0;
+extern volatile uint8_t PCMSK1;
+extern volatile uint8_t GIMSK;
+extern volatile uint8_t MCUSR;
+
+#define PINA0 0
+#define PINA1 1
+#define PINA2 2
+#define PINA3 3
+#define PINA4 4
+#define PINA5 5
+#define PINA6 6
+#define PINA7 7
+
+#define PINB0 0
+#define PINB1 1
+#define PINB2 2
+#define PINB3 3
+
+#define CS01 1
+#define OCIE0A 1
+#define PCINT9 1
+#define PCINT10 2
+#define PCIE1 5
+#define PORF 0
+#define WDRF 3
+
+#define FLASHEND 0x0FFF
+#define SPM_PAGESIZE 64
+#define _VECTORS_SIZE 34
+
+#endif /* SIM_AVR_IO_H_ */
@@ -0,0 +1,30 @@
+/*
+This file is part of mad-phenom.
+
+mad-phenom is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+mad-phenom is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with mad-phenom.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef SIM_AVR_PGMSPACE_H_
+#define SIM_AVR_PGMSPACE_H_
+
+#include <stdint.h>
+
+// Flash and RAM share one address space on the host.
+#define PROGMEM
+#define pgm_read_byte(address) (*(const uint8_t *)(address))
+
+// Numeric flash addresses read the simulated program memory instead
+extern uint8_t sim_flash[];
+#define pgm_read_word_near(address) (sim_flash[(address)] | (sim_flash[(address) + 1] << 8))
+
+#endif /* SIM_AVR_PGMSPACE_H_ */
@@ -0,0 +1,185 @@
+/*
+This file is part of mad-phenom.
+
+mad-phenom is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+mad-phenom is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with mad-phenom.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/************************************************************************/
+/* Replays a recorded trigger/button/selector trace through the firing  */
+/* core and prints the resulting shot timeline.  With -g the timeline   */
+/* is compared against a golden file and any change in shot count,      */
+/* cadence or latency fails the run.  sim/check.sh does this for every  */
+/* trace in sim/traces against its timeline in sim/golden.              */
+/*                                                                      */
+/* Build from x7classic/:                                               */
+/*   gcc -std=gnu99 -O2 -Isim/host -o replay sim/replay.c sim/sim.c     */
+/*       sim/trace.c sim/timeline.c Program.c Common.c Globals.c        */
+/*       Trigger.c Solenoid.c PushButton.c Battery.c Trainer.c          */
+/************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "sim.h"
+#include "trace.h"
+#include "timeline.h"
+#include "../Trigger.h"
+#include "../Battery.h"
+#include "../Trainer.h"
+
+// Time allowed after the last event for queued shots to finish
+#define REPLAY_TAIL_US 2000000
+
+static void usage() {
+	fprintf(stderr,
+		"usage: replay [options] trace\n"
+		"  -b bps       balls per second (5-40, default 20)\n"
+		"  -m mode      0 full auto, 1 burst, 2 auto response, 3 semi, 4 custom,\n"
+		"               5 trainer (default 3)\n"
+		"  -P program   custom firing program, e.g. \"pull 1; if_rate 6; repeat 2\" (sets -m 4)\n"
+		"  -s size      burst size (default 3)\n"
+		"  -a limit     ammo limit (default 0, off)\n"
+		"  -S shots     safety shots (default 0)\n"
+		"  -B depth     auto response shot buffer depth (0-4, default 2)\n"
+		"  -p us        main loop pass time (default 25)\n"
+		"  -o file      write the timeline to file instead of stdout\n"
+		"  -g file      compare against a golden timeline\n"
+		"  -t us        tolerance for the golden comparison (default 0)\n"
+		"  -x           use the alternate presets 2 and 3 from fuzz\n"
+		"  -M mode      firing mode with the selector closed (FA), default as -m\n"
+		"  -e peak,sus  expect this best pull speed in EEPROM at the end, in pulls/s\n"
+		"  -d           print the trigger switch health, buffer, battery and pull speed\n"
+		"               counters to stderr\n");
+	exit(2);
+}
+
+int main(int argc, char **argv) {
+	sim_config config;
+	const char *outPath = NULL;
+	const char *goldenPath = NULL;
+	uint32_t tolerance = 0;
+	bool diagnostics = false;
+	bool alternatePresets = false;
+	int closedMode = -1;
+	const char *expectedBest = NULL;
+	int option;
+
+	sim_defaultConfig(&config);
+
+	while ((option = getopt(argc, argv, "b:m:s:a:S:B:P:p:o:g:t:dxM:e:")) != -1) {
+		switch (option) {
+			case 'b': config.ballsPerSecond = atoi(optarg); break;
+			case 'm': config.firingMode = atoi(optarg); break;
+			case 's': config.burstSize = atoi(optarg); break;
+			case 'a': config.ammoLimit = atoi(optarg); break;
+			case 'S': config.safetyShot = atoi(optarg); break;
+			case 'B': config.bufferDepth = atoi(optarg); break;
+			case 'P':
+				if (!sim_assembleProgram(optarg, config.program)) {
+					return 2;
+				}
+				config.firingMode = MODE_CUSTOM;
+				break;
+			case 'p': config.passTime = atoi(optarg); break;
+			case 'o': outPath = optarg; break;
+			case 'g': goldenPath = optarg; break;
+			case 't': tolerance = strtoul(optarg, NULL, 10); break;
+			case 'd': diagnostics = true; break;
+			case 'x': alternatePresets = true; break;
+			case 'M': closedMode = atoi(optarg); break;
+			case 'e': expectedBest = optarg; break;
+			default: usage();
+		}
+	}
+
+	if (optind != argc - 1) {
+		usage();
+	}
+
+	trace input;
+	trace_init(&input);
+	if (!trace_load(argv[optind], &input)) {
+		return 2;
+	}
+
+	sim_init(&config);
+	if (alternatePresets) {
+		sim_alternatePresets(&config);
+	}
+	if (closedMode >= 0) {
+		EEPROM_FIRING_MODE[1][0] = closedMode;
+	}
+	trace_play(&input, REPLAY_TAIL_US);
+	trace_free(&input);
+
+	if (diagnostics) {
+		for (uint8_t i = 0; i < 2; i++) {
+			const trigger_switch *sw = &trigger_switches[i];
+
+			fprintf(stderr, "%s: bounces %u, leads %u, lag %u ms (worst %u), stuck open %u, stuck closed %u\n",
+				sim_signalName(SIM_TRIGGER_1 + i), sw->health.bounces, sw->health.leads, sw->lastLag,
+				sw->health.worstLag, sw->health.stuckOpen, sw->health.stuckClosed);
+		}
+
+		fprintf(stderr, "shot buffer: depth seen");
+		for (uint8_t i = 0; i < MAX_BUFFER_DEPTH + 2; i++) {
+			fprintf(stderr, " %u:%u", i, buffer_stats.depth[i]);
+		}
+		fprintf(stderr, ", dropped %u, expired %u\n", buffer_stats.dropped, buffer_stats.expired);
+
+		fprintf(stderr, "battery: %lu uC used, %u shots, %lu uC last shot, %lu shots remaining\n",
+			(unsigned long) battery.used, battery.shots, (unsigned long) battery_shotCharge,
+			(unsigned long) battery_remainingShots());
+
+		fprintf(stderr, "pull speed: last string peak %u, sustained %u pulls/s; best peak %u, sustained %u\n",
+			trainer_peakRate(&trainer_last), trainer_sustainedRate(&trainer_last),
+			trainer_peakRate(&trainer_best), trainer_sustainedRate(&trainer_best));
+	}
+
+	FILE *out = stdout;
+	if (outPath && !(out = fopen(outPath, "w"))) {
+		perror(outPath);
+		return 2;
+	}
+	timeline_write(out, sim_shots, sim_shotCount);
+	if (out != stdout) {
+		fclose(out);
+	}
+
+	if (expectedBest) {
+		const trainer_result *stored = &EEPROM_TRAINER[1];
+		unsigned peak = 0, sustained = 0;
+
+		sscanf(expectedBest, "%u,%u", &peak, &sustained);
+		if (trainer_peakRate(stored) != peak || trainer_sustainedRate(stored) != sustained) {
+			fprintf(stderr, "stored best pull speed: expected peak %u, sustained %u, got %u, %u\n",
+				peak, sustained, trainer_peakRate(stored), trainer_sustainedRate(stored));
+			return 1;
+		}
+	}
+
+	if (goldenPath) {
+		static sim_shot golden[SIM_MAX_SHOTS];
+		int goldenCount = timeline_load(goldenPath, golden, SIM_MAX_SHOTS);
+		if (goldenCount < 0) {
+			return 2;
+		}
+
+		uint16_t differences = timeline_compare(golden, goldenCount, sim_shots, sim_shotCount, tolerance, stderr);
+		if (differences > 0) {
+			fprintf(stderr, "%u timing difference(s) against %s\n", differences, goldenPath);
+			return 1;
+		}
+	}
+
+	return 0;
+}
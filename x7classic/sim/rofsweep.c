@@ -0,0 +1,184 @@
+/*
+This file is part of mad-phenom.
+
+mad-phenom is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+mad-phenom is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with mad-phenom.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/************************************************************************/
+/* Rate of fire accuracy sweep.  For every firing mode, burst size and  */
+/* BALLS_PER_SECOND from 5 to 40 the trigger is worked faster than the  */
+/* cap allows and the intervals between PA7 rising edges are measured.  */
+/* The table shows how far the real cadence is from the configured     */
+/* rate, including the 1.024ms tick and the ROUND_DELAY truncation.     */
+/* Rows marked OVER will read above the cap on a chronograph.           */
+/*                                                                      */
+/* Build from x7classic/:                                               */
+/*   gcc -std=gnu99 -O2 -Isim/host -o rofsweep sim/rofsweep.c sim/sim.c */
+/*       Program.c Common.c Globals.c Trigger.c Solenoid.c PushButton.c */
+/*       Battery.c Trainer.c -lm                                        */
+/************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <unistd.h>
+#include "sim.h"
+
+#define SWEEP_STRING_US 3000000 // length of each test string
+
+typedef struct {
+	double meanInterval; // us
+	double jitter;       // us, standard deviation
+	uint32_t minInterval;
+	uint32_t maxInterval;
+	uint16_t samples;
+	uint16_t shots;
+} sweep_result;
+
+static uint16_t passTime = 25;
+
+/************************************************************************/
+/* Full auto holds the trigger.  Every other mode is pulled as fast as  */
+/* the debounce allows so the cap, not the player, sets the cadence.    */
+/************************************************************************/
+static void driveTrigger(const sim_config *config) {
+	uint32_t time = 10000;
+
+	if (config->firingMode == 0) {
+		sim_runUntil(time);
+		sim_setInput(SIM_TRIGGER_1, true);
+		sim_runUntil(time + SWEEP_STRING_US);
+		sim_setInput(SIM_TRIGGER_1, false);
+		return;
+	}
+
+	// Burst needs time for the whole burst to leave before the next pull
+	uint32_t period = 44000;
+	if (config->firingMode == 1) {
+		period = (uint32_t)config->burstSize * (1000000 / config->ballsPerSecond) + 50000;
+	}
+
+	while (time < 10000 + SWEEP_STRING_US) {
+		sim_runUntil(time);
+		sim_setInput(SIM_TRIGGER_1, true);
+		sim_runUntil(time + period / 2);
+		sim_setInput(SIM_TRIGGER_1, false);
+		time += period;
+	}
+}
+
+static void runSweep(void *arg, void *result) {
+	const sim_config *config = arg;
+	sweep_result *out = result;
+	double target = 1000000.0 / config->ballsPerSecond;
+	double sum = 0;
+	double sumSquares = 0;
+
+	sim_init(config);
+	driveTrigger(config);
+	sim_runUntil(sim_time + 1000000);
+
+	out->minInterval = UINT32_MAX;
+	out->maxInterval = 0;
+	out->samples = 0;
+	out->shots = sim_shotCount;
+
+	for (uint16_t i = 1; i < sim_shotCount; i++) {
+		uint32_t interval = sim_shots[i].onTime - sim_shots[i - 1].onTime;
+
+		// Gaps between bursts or pulls are the player, not the cap
+		bool samePull = sim_shots[i].pullTime == sim_shots[i - 1].pullTime;
+		if ((config->firingMode == 1 && !samePull) || interval > target * 1.5) {
+			continue;
+		}
+
+		sum += interval;
+		sumSquares += (double)interval * interval;
+		out->samples++;
+
+		if (interval < out->minInterval) {
+			out->minInterval = interval;
+		}
+		if (interval > out->maxInterval) {
+			out->maxInterval = interval;
+		}
+	}
+
+	if (out->samples > 0) {
+		out->meanInterval = sum / out->samples;
+		out->jitter = sqrt(sumSquares / out->samples - out->meanInterval * out->meanInterval);
+	}
+}
+
+static void printRow(const sim_config *config) {
+	sweep_result result;
+	double target = 1000000.0 / config->ballsPerSecond;
+	uint8_t roundDelay = (1000 - 8) / config->ballsPerSecond;
+
+	if (!sim_isolated(runSweep, (void *)config, &result, sizeof(result))) {
+		fprintf(stderr, "rofsweep: run failed\n");
+		exit(1);
+	}
+
+	if (result.samples == 0) {
+		printf("%4u %5u %4u %9.3f %5u %10.3f %10s\n", config->firingMode, config->burstSize,
+			config->ballsPerSecond, target / 1000, roundDelay, roundDelay * SIM_TICK_US / 1000.0, "-");
+		return;
+	}
+
+	double effective = 1000000.0 / result.meanInterval;
+	double error = (result.meanInterval - target) / target * 100;
+
+	printf("%4u %5u %4u %9.3f %5u %10.3f %10.3f %+7.2f %8.1f %8.3f %8.3f %7.2f %s\n",
+		config->firingMode, config->burstSize, config->ballsPerSecond, target / 1000,
+		roundDelay, roundDelay * SIM_TICK_US / 1000.0, result.meanInterval / 1000, error,
+		result.jitter, result.minInterval / 1000.0, result.maxInterval / 1000.0, effective,
+		(1000000.0 / result.minInterval > config->ballsPerSecond) ? "OVER" : "");
+}
+
+int main(int argc, char **argv) {
+	int option;
+
+	while ((option = getopt(argc, argv, "p:")) != -1) {
+		if (option == 'p') {
+			passTime = atoi(optarg);
+		} else {
+			fprintf(stderr, "usage: rofsweep [-p pass_us]\n");
+			return 2;
+		}
+	}
+
+	printf("# mode: 0 full auto, 1 burst, 2 auto response, 3 semi\n");
+	printf("# times in ms, error is mean interval vs configured, jitter is the std dev in us\n");
+	printf("# OVER: at least one interval was shorter than the configured rate allows\n");
+	printf("mode burst  bps target_ms delay predict_ms   mean_ms  err_%%  jitter   min_ms   max_ms     bps\n");
+
+	for (uint8_t mode = 0; mode <= 3; mode++) {
+		uint8_t firstBurst = (mode == 1) ? 2 : 3;
+		uint8_t lastBurst = (mode == 1) ? 10 : 3;
+
+		for (uint8_t burst = firstBurst; burst <= lastBurst; burst++) {
+			for (uint8_t bps = 5; bps <= 40; bps++) {
+				sim_config config;
+				sim_defaultConfig(&config);
+				config.firingMode = mode;
+				config.burstSize = burst;
+				config.ballsPerSecond = bps;
+				config.passTime = passTime;
+
+				printRow(&config);
+			}
+		}
+	}
+
+	return 0;
+}
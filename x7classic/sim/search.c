@@ -0,0 +1,454 @@
+/*
+This file is part of mad-phenom.
+
+mad-phenom is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+mad-phenom is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with mad-phenom.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/************************************************************************/
+/* Parameter search.  Every combination of dwell, release debounce,     */
+/* rate cap and shot buffer depth is run through the firing core over   */
+/* the given traces (or two synthetic ones) and the PA7 timelines are   */
+/* checked against the valve model at a fixed battery voltage.  Dwell   */
+/* and release debounce are not part of a preset, a result that changes */
+/* them needs a firmware build with the new values (see initialize).    */
+/*                                                                      */
+/* Configurations are ranked by effective rate of fire, first shot      */
+/* latency and solenoid energy per shot.  Ones the valve model rejects, */
+/* or that fire faster than the field cap, are ranked last.             */
+/*                                                                      */
+/* The firmware keeps its state in globals, so candidates cannot share  */
+/* an address space.  One worker process per core takes candidates in   */
+/* chunks from a counter in shared memory, so a worker that finishes    */
+/* early keeps taking work until none is left, and every candidate      */
+/* runs in its own forked child (sim_isolated).                         */
+/*                                                                      */
+/* Build from x7classic/:                                               */
+/*   gcc -std=gnu99 -O2 -Isim/host -o search sim/search.c sim/sim.c     */
+/*       sim/trace.c sim/valve.c Program.c Common.c Globals.c Trigger.c */
+/*       Solenoid.c PushButton.c Battery.c Trainer.c                    */
+/************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "sim.h"
+#include "trace.h"
+#include "valve.h"
+#include "../Battery.h"
+#include "../Globals.h"
+
+#define SEARCH_TAIL_US 500000
+#define SEARCH_MAX_TRACES 16
+#define SEARCH_CHUNK 8
+#define SEARCH_STRING_GAP 250000 // us, longer intervals are between strings
+
+// The grid, inclusive
+#define DWELL_MIN 4
+#define DWELL_MAX 14
+#define DEBOUNCE_MIN 10
+#define DEBOUNCE_MAX 30
+#define DEBOUNCE_STEP 5
+#define BPS_MIN 10
+#define BPS_MAX 40
+#define BPS_STEP 2
+
+#define DWELLS    (DWELL_MAX - DWELL_MIN + 1)
+#define DEBOUNCES ((DEBOUNCE_MAX - DEBOUNCE_MIN) / DEBOUNCE_STEP + 1)
+#define RATES     ((BPS_MAX - BPS_MIN) / BPS_STEP + 1)
+#define DEPTHS    (MAX_BUFFER_DEPTH + 1)
+#define CANDIDATES (DWELLS * DEBOUNCES * RATES * DEPTHS)
+
+#define KEY_ROF     0
+#define KEY_LATENCY 1
+#define KEY_ENERGY  2
+
+typedef struct {
+	uint8_t dwell;
+	uint8_t releaseDebounce;
+	uint8_t ballsPerSecond;
+	uint8_t bufferDepth;
+} search_candidate;
+
+// What one trace did under one candidate
+typedef struct {
+	uint16_t shots;
+	uint16_t pulls;
+	uint16_t intervals;
+	uint16_t valveFailures;
+	uint32_t intervalSum;  // us, shot to shot within a string
+	uint32_t minInterval;  // us
+	uint32_t latencySum;   // us, pull to its first shot
+	uint32_t maxLatency;   // us
+	uint32_t onTime;       // us PA7 was high
+} search_metrics;
+
+typedef struct {
+	search_candidate candidate;
+	bool done;
+	bool valid;     // Every shot cycled the valve model
+	bool overCap;
+	float rof;      // balls per second within strings
+	float latency;  // ms mean
+	float maxLatency;
+	float energy;   // mJ per shot
+	uint32_t shots;
+} search_result;
+
+typedef struct {
+	uint32_t next; // Next candidate index to hand out
+	search_result results[CANDIDATES];
+} search_shared;
+
+typedef struct {
+	sim_config config;
+	const trace *input;
+} search_run;
+
+static trace traces[SEARCH_MAX_TRACES];
+static uint8_t traceCount = 0;
+static sim_config baseConfig;
+static valve_model valve;
+static float voltage = 9.0f;
+static float fieldCap = 0;
+
+static search_candidate candidateAt(uint32_t index) {
+	search_candidate c;
+
+	c.bufferDepth = index % DEPTHS;
+	index /= DEPTHS;
+	c.ballsPerSecond = BPS_MIN + (index % RATES) * BPS_STEP;
+	index /= RATES;
+	c.releaseDebounce = DEBOUNCE_MIN + (index % DEBOUNCES) * DEBOUNCE_STEP;
+	index /= DEBOUNCES;
+	c.dwell = DWELL_MIN + index;
+	return c;
+}
+
+/************************************************************************/
+/* A string of pulls speeding up from 12 to 22 per second with a little */
+/* release bounce, then the trigger held for a second.                  */
+/************************************************************************/
+static void synthesize() {
+	trace *t = &traces[traceCount++];
+	uint32_t time = 20000;
+
+	trace_init(t);
+	for (uint8_t i = 0; i < 24; i++) {
+		uint32_t period = 83000 - (uint32_t) i * 1600;
+
+		trace_add(t, time, SIM_TRIGGER_1, true);
+		trace_add(t, time + 300, SIM_TRIGGER_2, true);
+		trace_add(t, time + 22000, SIM_TRIGGER_1, false);
+		trace_add(t, time + 22400, SIM_TRIGGER_1, true);
+		trace_add(t, time + 23000, SIM_TRIGGER_1, false);
+		trace_add(t, time + 23300, SIM_TRIGGER_2, false);
+		time += period;
+	}
+
+	t = &traces[traceCount++];
+	trace_init(t);
+	trace_add(t, 20000, SIM_TRIGGER_1, true);
+	trace_add(t, 20300, SIM_TRIGGER_2, true);
+	trace_add(t, 1020000, SIM_TRIGGER_1, false);
+	trace_add(t, 1020300, SIM_TRIGGER_2, false);
+}
+
+static void runTrace(void *arg, void *result) {
+	const search_run *run = arg;
+	search_metrics *out = result;
+	valve_result checked;
+
+	sim_init(&run->config);
+	trace_play(run->input, SEARCH_TAIL_US);
+
+	memset(out, 0, sizeof(search_metrics));
+	out->shots = sim_shotCount;
+	out->minInterval = UINT32_MAX;
+
+	for (uint16_t i = 0; i < sim_shotCount; i++) {
+		const sim_shot *shot = &sim_shots[i];
+
+		if (shot->offTime > shot->onTime) {
+			out->onTime += shot->offTime - shot->onTime;
+		}
+
+		if (i == 0 || shot->pullTime != sim_shots[i - 1].pullTime) {
+			uint32_t latency = shot->onTime - shot->pullTime;
+
+			out->pulls++;
+			out->latencySum += latency;
+			if (latency > out->maxLatency) {
+				out->maxLatency = latency;
+			}
+		}
+
+		if (i > 0) {
+			uint32_t interval = shot->onTime - sim_shots[i - 1].onTime;
+
+			if (interval < out->minInterval) {
+				out->minInterval = interval;
+			}
+			if (interval < SEARCH_STRING_GAP) {
+				out->intervals++;
+				out->intervalSum += interval;
+			}
+		}
+	}
+
+	valve_check(&valve, voltage, sim_shots, sim_shotCount, &checked);
+	out->valveFailures = checked.shots - checked.fired;
+}
+
+static void evaluate(uint32_t index, search_result *result) {
+	search_run run;
+	search_metrics total, metrics;
+
+	result->candidate = candidateAt(index);
+
+	run.config = baseConfig;
+	run.config.dwell = result->candidate.dwell;
+	run.config.releaseDebounce = result->candidate.releaseDebounce;
+	run.config.ballsPerSecond = result->candidate.ballsPerSecond;
+	run.config.bufferDepth = result->candidate.bufferDepth;
+
+	memset(&total, 0, sizeof(total));
+	total.minInterval = UINT32_MAX;
+
+	for (uint8_t i = 0; i < traceCount; i++) {
+		run.input = &traces[i];
+		if (!sim_isolated(runTrace, &run, &metrics, sizeof(metrics))) {
+			return;
+		}
+
+		total.shots += metrics.shots;
+		total.pulls += metrics.pulls;
+		total.intervals += metrics.intervals;
+		total.valveFailures += metrics.valveFailures;
+		total.intervalSum += metrics.intervalSum;
+		total.latencySum += metrics.latencySum;
+		total.onTime += metrics.onTime;
+		if (metrics.minInterval < total.minInterval) {
+			total.minInterval = metrics.minInterval;
+		}
+		if (metrics.maxLatency > total.maxLatency) {
+			total.maxLatency = metrics.maxLatency;
+		}
+	}
+
+	// Coil current follows the battery voltage, as in Battery.c
+	float amps = BATTERY_SOLENOID_CURRENT / 1000.0f * voltage * 10 / BATTERY_NOMINAL_VOLTAGE;
+
+	result->shots = total.shots;
+	result->valid = total.shots > 0 && total.valveFailures == 0;
+	result->overCap = fieldCap > 0 && total.minInterval < 1000000 / fieldCap;
+	result->rof = total.intervals ? 1000000.0f * total.intervals / total.intervalSum : 0;
+	result->latency = total.pulls ? total.latencySum / 1000.0f / total.pulls : 0;
+	result->maxLatency = total.maxLatency / 1000.0f;
+	result->energy = total.shots ? total.onTime / 1000.0f / total.shots * amps * voltage : 0;
+	result->done = true;
+}
+
+static void worker(search_shared *shared) {
+	for (;;) {
+		uint32_t first = __atomic_fetch_add(&shared->next, SEARCH_CHUNK, __ATOMIC_RELAXED);
+
+		if (first >= CANDIDATES) {
+			return;
+		}
+
+		for (uint32_t i = first; i < first + SEARCH_CHUNK && i < CANDIDATES; i++) {
+			evaluate(i, &shared->results[i]);
+		}
+	}
+}
+
+static int rankKey = KEY_ROF;
+
+// Keys are compared after rounding so near ties fall through to the next
+static float keyValue(const search_result *result, int key) {
+	switch (key) {
+		case KEY_LATENCY: return (int)(result->latency * 10 + 0.5f);
+		case KEY_ENERGY:  return (int)(result->energy * 10 + 0.5f);
+		default:          return -(int)(result->rof * 10 + 0.5f);
+	}
+}
+
+static int compareResults(const void *a, const void *b) {
+	const search_result *x = a;
+	const search_result *y = b;
+	int keys[3] = {rankKey, KEY_ROF, KEY_LATENCY};
+
+	if (x->valid != y->valid) {
+		return x->valid ? -1 : 1;
+	}
+	if (x->overCap != y->overCap) {
+		return x->overCap ? 1 : -1;
+	}
+
+	keys[1] = rankKey == KEY_ROF ? KEY_LATENCY : KEY_ROF;
+	keys[2] = rankKey == KEY_ENERGY ? KEY_LATENCY : KEY_ENERGY;
+
+	for (uint8_t i = 0; i < 3; i++) {
+		float kx = keyValue(x, keys[i]);
+		float ky = keyValue(y, keys[i]);
+
+		if (kx != ky) {
+			return kx < ky ? -1 : 1;
+		}
+	}
+
+	// Least dwell, debounce, rate and buffering, for a stable order
+	if (x->candidate.dwell != y->candidate.dwell) {
+		return x->candidate.dwell - y->candidate.dwell;
+	}
+	if (x->candidate.releaseDebounce != y->candidate.releaseDebounce) {
+		return x->candidate.releaseDebounce - y->candidate.releaseDebounce;
+	}
+	if (x->candidate.ballsPerSecond != y->candidate.ballsPerSecond) {
+		return x->candidate.ballsPerSecond - y->candidate.ballsPerSecond;
+	}
+	return x->candidate.bufferDepth - y->candidate.bufferDepth;
+}
+
+static void usage() {
+	fprintf(stderr,
+		"usage: search [options] [trace ...]\n"
+		"  -m mode      firing mode (default 2, auto response)\n"
+		"  -c bps       field cap, configurations that fire faster rank last (default off)\n"
+		"  -k key       rank by rof, latency or energy first (default rof)\n"
+		"  -v volts     battery voltage for the valve and energy models (default 9.0),\n"
+		"               held fixed for the whole run, the battery is not discharged\n"
+		"  -i us        solenoid pull-in time at the nominal voltage (default 4500)\n"
+		"  -j workers   worker processes (default one per core)\n"
+		"  -n count     configurations to print (default 20)\n"
+		"  -p us        main loop pass time (default 25)\n"
+		"With no traces, two synthetic ones are used.\n");
+	exit(2);
+}
+
+int main(int argc, char **argv) {
+	long workers = sysconf(_SC_NPROCESSORS_ONLN);
+	uint32_t printCount = 20;
+	int option;
+
+	sim_defaultConfig(&baseConfig);
+	baseConfig.firingMode = 2;
+	valve_defaultModel(&valve);
+
+	while ((option = getopt(argc, argv, "m:c:k:v:i:j:n:p:")) != -1) {
+		switch (option) {
+			case 'm': baseConfig.firingMode = atoi(optarg); break;
+			case 'c': fieldCap = atof(optarg); break;
+			case 'k':
+				if (strcmp(optarg, "latency") == 0) {
+					rankKey = KEY_LATENCY;
+				} else if (strcmp(optarg, "energy") == 0) {
+					rankKey = KEY_ENERGY;
+				} else if (strcmp(optarg, "rof") == 0) {
+					rankKey = KEY_ROF;
+				} else {
+					usage();
+				}
+				break;
+			case 'v': voltage = atof(optarg); break;
+			case 'i': valve.pullIn = atoi(optarg); break;
+			case 'j': workers = atol(optarg); break;
+			case 'n': printCount = strtoul(optarg, NULL, 10); break;
+			case 'p': baseConfig.passTime = atoi(optarg); break;
+			default: usage();
+		}
+	}
+
+	for (int i = optind; i < argc; i++) {
+		if (traceCount >= SEARCH_MAX_TRACES) {
+			fprintf(stderr, "search: at most %u traces\n", SEARCH_MAX_TRACES);
+			return 2;
+		}
+
+		trace_init(&traces[traceCount]);
+		if (!trace_load(argv[i], &traces[traceCount])) {
+			return 2;
+		}
+		traceCount++;
+	}
+	if (traceCount == 0) {
+		synthesize();
+	}
+	if (workers < 1) {
+		workers = 1;
+	}
+
+	search_shared *shared = mmap(NULL, sizeof(search_shared), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (shared == MAP_FAILED) {
+		perror("search: mmap");
+		return 1;
+	}
+	memset(shared, 0, sizeof(search_shared));
+
+	for (long i = 0; i < workers; i++) {
+		pid_t child = fork();
+
+		if (child == 0) {
+			worker(shared);
+			_exit(0);
+		} else if (child < 0) {
+			perror("search: fork");
+			break;
+		}
+	}
+	while (wait(NULL) > 0);
+
+	uint32_t done = 0;
+	for (uint32_t i = 0; i < CANDIDATES; i++) {
+		if (shared->results[i].done) {
+			done++;
+		}
+	}
+	if (done < CANDIDATES) {
+		fprintf(stderr, "search: %lu of %u candidates failed\n", (unsigned long)(CANDIDATES - done), CANDIDATES);
+	}
+
+	qsort(shared->results, CANDIDATES, sizeof(search_result), compareResults);
+
+	// Dwell and release debounce as the firmware sets them at boot
+	sim_init(&baseConfig);
+
+	printf("# mode %u, %u traces, %u candidates on %ld workers, %.1f V fixed, pull-in %u us",
+		baseConfig.firingMode, traceCount, CANDIDATES, workers, voltage, valve.pullIn);
+	if (fieldCap > 0) {
+		printf(", cap %.1f bps", fieldCap);
+	}
+	printf("\n# the firmware builds with dwell %u ms and release debounce %u ms\n", DWELL, RELEASE_DEBOUNCE);
+	printf("# rof in balls per second within strings, latency in ms from pull to first shot\n");
+	printf("rank dwell debounce  bps buffer    rof  latency  max_lat  mJ/shot  shots  notes\n");
+
+	for (uint32_t i = 0; i < printCount && i < CANDIDATES; i++) {
+		const search_result *r = &shared->results[i];
+
+		if (!r->done) {
+			continue;
+		}
+
+		printf("%4lu %5u %8u %4u %6u %6.2f %8.3f %8.3f %8.1f %6lu  %s%s\n",
+			(unsigned long)(i + 1), r->candidate.dwell, r->candidate.releaseDebounce,
+			r->candidate.ballsPerSecond, r->candidate.bufferDepth, r->rof, r->latency,
+			r->maxLatency, r->energy, (unsigned long)r->shots,
+			r->valid ? "" : "valve ", r->overCap ? "OVER" : "");
+	}
+
+	munmap(shared, sizeof(search_shared));
+	return 0;
+}
@@ -0,0 +1,394 @@
+/*
+This file is part of mad-phenom.
+
+mad-phenom is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+mad-phenom is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with mad-phenom.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <avr/io.h>
+#include <avr/boot.h>
+#include <util/delay.h>
+#include "sim.h"
+#include "../Globals.h"
+#include "../Common.h"
+#include "../Trigger.h"
+#include "../PushButton.h"
+#include "../Pins.h"
+#include "../Battery.h"
+#include "../Trainer.h"
+
+volatile uint8_t PINA;
+volatile uint8_t PINB;
+volatile uint8_t PORTA;
+volatile uint8_t PORTB;
+volatile uint8_t DDRA;
+volatile uint8_t DDRB;
+volatile uint8_t TCCR0B;
+volatile uint8_t TIMSK0;
+volatile uint8_t OCR0A;
+volatile uint8_t TCNT0;
+volatile uint8_t PCMSK1;
+volatile uint8_t GIMSK;
+volatile uint8_t MCUSR;
+
+uint32_t sim_time = 0;
+volatile uint32_t sim_millis = 0;
+sim_shot sim_shots[SIM_MAX_SHOTS];
+uint16_t sim_shotCount = 0;
+uint32_t sim_lastPullTime = 0;
+uint32_t sim_readyTime = 0;
+uint32_t sim_configTime = 0;
+void (*sim_delayHook)() = 0;
+
+uint8_t sim_flash[FLASHEND + 1];
+uint16_t sim_spmCount = 0;
+static uint8_t pageBuffer[SPM_PAGESIZE] = {[0 ... SPM_PAGESIZE - 1] = 0xFF};
+
+static uint16_t passTime = 25;
+static bool solenoidWasOn = false;
+static uint16_t eepromCycles = 0;
+
+static const char *signalNames[SIM_SIGNALS] = {"trigger1", "trigger2", "button", "selector"};
+
+void sim_defaultConfig(sim_config *config) {
+	config->ballsPerSecond = 20;
+	config->firingMode = 3;
+	config->burstSize = 3;
+	config->ammoLimit = 0;
+	config->safetyShot = 0;
+	config->bufferDepth = 2;
+	memset(config->program, OP_END, PROGRAM_SIZE);
+	config->passTime = 25;
+	config->closedAtPowerOn = 0;
+	config->dwell = 0;
+	config->releaseDebounce = 0;
+}
+
+static void updateClock() {
+	sim_millis = sim_time / SIM_TICK_US;
+}
+
+/************************************************************************/
+/* Samples PA7 after each main loop pass and records shot edges         */
+/************************************************************************/
+static void sampleSolenoid() {
+	bool on = sim_solenoidOn();
+
+	if (on && !solenoidWasOn && sim_shotCount < SIM_MAX_SHOTS) {
+		sim_shots[sim_shotCount].onTime = sim_time;
+		sim_shots[sim_shotCount].offTime = 0;
+		sim_shots[sim_shotCount].pullTime = sim_lastPullTime;
+		sim_shotCount++;
+	} else if (!on && solenoidWasOn && sim_shotCount > 0) {
+		sim_shots[sim_shotCount - 1].offTime = sim_time;
+	}
+
+	solenoidWasOn = on;
+}
+
+void _delay_ms(double ms) {
+	_delay_us(ms * 1000);
+}
+
+void _delay_us(double us) {
+	sim_time += (uint32_t)us;
+	updateClock();
+	sampleSolenoid();
+
+	if (sim_delayHook) {
+		sim_delayHook();
+	}
+}
+
+/************************************************************************/
+/* EEPROM reads.  Each byte halts the CPU for 4 cycles, about 20 with   */
+/* the avr-libc call around it.  Whole microseconds go onto the clock,  */
+/* the rest carries over to the next read.                              */
+/************************************************************************/
+void sim_eepromRead(size_t size) {
+	eepromCycles += size * SIM_EEPROM_READ_CYCLES;
+
+	if (eepromCycles >= SIM_CYCLES_PER_US) {
+		sim_time += eepromCycles / SIM_CYCLES_PER_US;
+		eepromCycles %= SIM_CYCLES_PER_US;
+		updateClock();
+		sampleSolenoid();
+	}
+}
+
+/************************************************************************/
+/* Self-programming.  Erase and write each halt the ATtiny44A for up to */
+/* 4.5ms, the temporary page buffer is cleared by a write.  A power cut */
+/* in either window is taken at its worst: the page is already erased,  */
+/* but not yet written.                                                 */
+/************************************************************************/
+void boot_page_erase(uint16_t address) {
+	memset(&sim_flash[address & ~(SPM_PAGESIZE - 1) & FLASHEND], 0xFF, SPM_PAGESIZE);
+	sim_spmCount++;
+	_delay_us(SIM_SPM_US);
+}
+
+void boot_page_fill(uint16_t address, uint16_t data) {
+	pageBuffer[address & (SPM_PAGESIZE - 2)] = data & 0xFF;
+	pageBuffer[(address & (SPM_PAGESIZE - 2)) + 1] = data >> 8;
+}
+
+void boot_page_write(uint16_t address) {
+	sim_spmCount++;
+	_delay_us(SIM_SPM_US);
+
+	uint8_t *page = &sim_flash[address & ~(SPM_PAGESIZE - 1) & FLASHEND];
+	for (uint8_t i = 0; i < SPM_PAGESIZE; i++) {
+		page[i] &= pageBuffer[i];
+	}
+	memset(pageBuffer, 0xFF, SPM_PAGESIZE);
+}
+
+void sim_init(const sim_config *config) {
+	PINA = 0;
+	PINB = 0;
+	PORTA = 0;
+	PORTB = 0;
+	PIN_HIGH(POWER);
+	PIN_INPUT_PULLUP(TRIGGER_1);
+	PIN_INPUT_PULLUP(TRIGGER_2);
+	PIN_INPUT_PULLUP(BUTTON);
+	PIN_INPUT_PULLUP(SELECTOR);
+
+	// Every switch open, the pull-ups leave the pins high
+	TRIGGER_1_PIN |= (1 << TRIGGER_1_BIT);
+	TRIGGER_2_PIN |= (1 << TRIGGER_2_BIT);
+	BUTTON_PIN |= (1 << BUTTON_BIT);
+	SELECTOR_PIN |= (1 << SELECTOR_BIT);
+
+	for (uint8_t selector = 0; selector < 2; selector++) {
+		EEPROM_BALLS_PER_SECOND[selector][0] = config->ballsPerSecond;
+		EEPROM_FIRING_MODE[selector][0] = config->firingMode;
+		EEPROM_BURST_SIZE[selector][0] = config->burstSize;
+		EEPROM_AMMO_LIMIT[selector][0] = config->ammoLimit;
+		EEPROM_SAFETY_SHOT[selector][0] = config->safetyShot;
+		EEPROM_BUFFER_DEPTH[selector][0] = config->bufferDepth;
+	}
+	memcpy(EEPROM_PROGRAM[0][0], config->program, PROGRAM_SIZE);
+	memcpy(EEPROM_PROGRAM[1][0], config->program, PROGRAM_SIZE);
+	EEPROM_PRESET_1 = 0;
+	EEPROM_PRESET_2 = 0;
+
+	// Every run starts on a fresh battery
+	memset(&EEPROM_BATTERY, 0xFF, sizeof(EEPROM_BATTERY));
+	memset(EEPROM_TRAINER, 0xFF, sizeof(EEPROM_TRAINER));
+	memset(EEPROM_SWITCH_HEALTH, 0xFF, sizeof(EEPROM_SWITCH_HEALTH));
+
+	passTime = config->passTime > 0 ? config->passTime : 1;
+	sim_time = 0;
+	eepromCycles = 0;
+	sim_shotCount = 0;
+	sim_lastPullTime = 0;
+	sim_configTime = 0;
+	solenoidWasOn = false;
+	updateClock();
+
+	for (uint8_t signal = 0; signal < SIM_SIGNALS; signal++) {
+		if (config->closedAtPowerOn & (1 << signal)) {
+			sim_setInput(signal, true);
+		}
+	}
+
+	// The same boot path as main(), any busy wait in it shows up here
+	initialize();
+	pushbutton_boot();
+
+	// Tuning overrides, a preset swap keeps them
+	if (config->dwell > 0) {
+		DWELL = config->dwell;
+		ROUND_DELAY = (1000 - DWELL) / BALLS_PER_SECOND;
+	}
+	if (config->releaseDebounce > 0) {
+		RELEASE_DEBOUNCE = config->releaseDebounce;
+	}
+
+	sim_readyTime = sim_time;
+}
+
+/************************************************************************/
+/* Makes presets 2 and 3 differ from preset 1 so preset toggles mid     */
+/* string actually change the settings under the firing core.  Call it  */
+/* after sim_init().                                                    */
+/************************************************************************/
+void sim_alternatePresets(const sim_config *config) {
+	EEPROM_BALLS_PER_SECOND[0][1] = EEPROM_BALLS_PER_SECOND[1][1] = 40;
+	EEPROM_FIRING_MODE[0][1] = EEPROM_FIRING_MODE[1][1] = (config->firingMode + 1) % 4;
+	EEPROM_BURST_SIZE[0][1] = EEPROM_BURST_SIZE[1][1] = 5;
+	EEPROM_BUFFER_DEPTH[0][1] = EEPROM_BUFFER_DEPTH[1][1] = 4;
+
+	EEPROM_BALLS_PER_SECOND[0][2] = EEPROM_BALLS_PER_SECOND[1][2] = 8;
+	EEPROM_FIRING_MODE[0][2] = EEPROM_FIRING_MODE[1][2] = (config->firingMode + 2) % 4;
+	EEPROM_BURST_SIZE[0][2] = EEPROM_BURST_SIZE[1][2] = 2;
+	EEPROM_BUFFER_DEPTH[0][2] = EEPROM_BUFFER_DEPTH[1][2] = 0;
+}
+
+void sim_setInput(uint8_t signal, bool closed) {
+	volatile uint8_t *pin;
+	uint8_t bit;
+
+	switch (signal) {
+		case SIM_TRIGGER_1: pin = &TRIGGER_1_PIN; bit = TRIGGER_1_BIT; break;
+		case SIM_TRIGGER_2: pin = &TRIGGER_2_PIN; bit = TRIGGER_2_BIT; break;
+		case SIM_BUTTON:    pin = &BUTTON_PIN;    bit = BUTTON_BIT;    break;
+		default:            pin = &SELECTOR_PIN;  bit = SELECTOR_BIT;  break;
+	}
+
+	bool wasClosed = ((*pin) & (1 << bit)) == 0;
+	bool otherTriggerClosed = (signal == SIM_TRIGGER_1) ? PIN_CLOSED(TRIGGER_2) : PIN_CLOSED(TRIGGER_1);
+
+	if (closed) {
+		*pin &= ~(1 << bit);
+	} else {
+		*pin |= (1 << bit);
+	}
+
+	// A pull is the first closing edge of either trigger switch
+	if (closed && !wasClosed && !otherTriggerClosed
+		&& (signal == SIM_TRIGGER_1 || signal == SIM_TRIGGER_2)) {
+		sim_lastPullTime = sim_time;
+	}
+}
+
+/************************************************************************/
+/* Runs the main loop until the virtual clock reaches time (us)         */
+/************************************************************************/
+void sim_runUntil(uint32_t time) {
+	while (sim_time < time) {
+		// The marker has gone into config mode, nothing fires any more
+		if (sim_configTime == 0) {
+			trigger_run(&sim_millis);
+			pushbutton_run(&sim_millis);
+			battery_run(&sim_millis);
+			trainer_run(&sim_millis);
+
+			if (pushbutton_configRequested(&sim_millis)) {
+				sim_configTime = sim_time;
+				solenoidOff();
+			}
+		}
+
+		sim_time += passTime;
+		updateClock();
+		sampleSolenoid();
+	}
+}
+
+bool sim_solenoidOn() {
+	return (SOLENOID_PORT & (1 << SOLENOID_BIT)) != 0;
+}
+
+const char *sim_signalName(uint8_t signal) {
+	return signal < SIM_SIGNALS ? signalNames[signal] : "?";
+}
+
+int sim_signalFromName(const char *name) {
+	for (uint8_t i = 0; i < SIM_SIGNALS; i++) {
+		if (strcmp(name, signalNames[i]) == 0) {
+			return i;
+		}
+	}
+
+	// Accept the raw pin names used in logic analyzer captures
+	if (strcmp(name, "PB2") == 0) return SIM_TRIGGER_1;
+	if (strcmp(name, "PA6") == 0) return SIM_TRIGGER_2;
+	if (strcmp(name, "PB1") == 0) return SIM_BUTTON;
+	if (strcmp(name, "PB0") == 0) return SIM_SELECTOR;
+
+	return -1;
+}
+
+/************************************************************************/
+/* Assembles a firing program, e.g. "pull 1; if_rate 6; repeat 2 safe". */
+/* Instructions are separated by ';', "safe" sets the S flag.           */
+/************************************************************************/
+bool sim_assembleProgram(const char *text, uint8_t *program) {
+	static const struct {
+		const char *name;
+		uint8_t op;
+	} ops[] = {
+		{"end", OP_END}, {"pull", OP_PULL}, {"pull_add", OP_PULL_ADD},
+		{"release", OP_RELEASE}, {"repeat", OP_REPEAT}, {"if_rate", OP_IF_RATE},
+	};
+	char copy[256];
+	uint8_t count = 0;
+
+	strncpy(copy, text, sizeof(copy) - 1);
+	copy[sizeof(copy) - 1] = '\0';
+	memset(program, OP_END, PROGRAM_SIZE);
+
+	for (char *step = strtok(copy, ";"); step; step = strtok(NULL, ";")) {
+		char name[16] = "";
+		char flag[16] = "";
+		unsigned arg = 0;
+		uint8_t i;
+
+		if (sscanf(step, "%15s %u %15s", name, &arg, flag) < 1) {
+			continue;
+		}
+
+		for (i = 0; i < sizeof(ops) / sizeof(ops[0]); i++) {
+			if (strcmp(name, ops[i].name) == 0) {
+				break;
+			}
+		}
+
+		if (i == sizeof(ops) / sizeof(ops[0]) || arg > ARG_MASK || count == PROGRAM_SIZE
+			|| (flag[0] && strcmp(flag, "safe") != 0)) {
+			fprintf(stderr, "program: bad instruction '%s'\n", step);
+			return false;
+		}
+
+		program[count++] = ops[i].op | (flag[0] ? OP_SAFE : 0) | arg;
+	}
+
+	return true;
+}
+
+/************************************************************************/
+/* The firmware keeps its state in statically initialized globals, so   */
+/* every run that needs a cold marker happens in a forked child.  The   */
+/* child writes size bytes of result into shared memory.                */
+/************************************************************************/
+bool sim_isolated(void (*run)(void *arg, void *result), void *arg, void *result, size_t size) {
+	void *shared = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (shared == MAP_FAILED) {
+		return false;
+	}
+
+	pid_t child = fork();
+	if (child == 0) {
+		run(arg, shared);
+		_exit(0);
+	}
+
+	int status = 0;
+	bool ok = child > 0 && waitpid(child, &status, 0) == child
+		&& WIFEXITED(status) && WEXITSTATUS(status) == 0;
+
+	if (ok) {
+		memcpy(result, shared, size);
+	}
+
+	munmap(shared, size);
+	return ok;
+}
@@ -0,0 +1,92 @@
+/*
+This file is part of mad-phenom.
+
+mad-phenom is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+mad-phenom is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with mad-phenom.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef SIM_H_
+#define SIM_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "../Program.h"
+
+/************************************************************************/
+/* Host simulator for the firing core.  The unmodified trigger_run and  */
+/* pushbutton_run are called in virtual time; the simulator drives the  */
+/* input pins and records every rising/falling edge of PA7 as a shot.   */
+/************************************************************************/
+
+// Input signals (all active low on the marker)
+#define SIM_TRIGGER_1 0 // PB2
+#define SIM_TRIGGER_2 1 // PA6
+#define SIM_BUTTON    2 // PB1
+#define SIM_SELECTOR  3 // PB0 (closed = FA)
+#define SIM_SIGNALS   4
+
+// One millis tick is 4 timer0 compare matches at 1MHz / 256 = 1.024ms
+#define SIM_TICK_US 1024
+
+// 8MHz system clock, an eeprom_read_byte() call takes about 20 cycles
+#define SIM_CYCLES_PER_US 8
+#define SIM_EEPROM_READ_CYCLES 20
+
+#define SIM_MAX_SHOTS 4096
+
+// us the CPU halts for a flash page erase or write
+#define SIM_SPM_US 4500
+
+typedef struct {
+	uint32_t onTime;   // us when PA7 went high
+	uint32_t offTime;  // us when PA7 went low (0 while still energized)
+	uint32_t pullTime; // us of the trigger pull that preceded the shot
+} sim_shot;
+
+typedef struct {
+	uint8_t ballsPerSecond;
+	uint8_t firingMode;
+	uint8_t burstSize;
+	uint8_t ammoLimit;
+	uint8_t safetyShot;
+	uint8_t bufferDepth;
+	uint8_t program[PROGRAM_SIZE]; // Used when firingMode is MODE_CUSTOM
+	uint16_t passTime; // us taken by one main loop iteration
+	uint8_t closedAtPowerOn; // (1 << signal) for each input already closed at reset
+	uint8_t dwell;           // ms, 0 keeps the firmware's DWELL
+	uint8_t releaseDebounce; // ms, 0 keeps the firmware's RELEASE_DEBOUNCE
+} sim_config;
+
+extern uint32_t sim_time; // virtual time in us
+extern volatile uint32_t sim_millis;
+extern sim_shot sim_shots[SIM_MAX_SHOTS];
+extern uint16_t sim_shotCount;
+extern uint32_t sim_lastPullTime;
+extern uint32_t sim_readyTime;  // us from reset to the first main loop pass
+extern uint32_t sim_configTime; // us when the main loop left for config mode, 0 if it never did
+extern void (*sim_delayHook)(); // Called after every busy wait, e.g. to drive inputs meanwhile
+extern uint8_t sim_flash[];     // Program memory as seen by the bootloader
+extern uint16_t sim_spmCount;   // Flash page erases and writes so far
+
+void sim_defaultConfig(sim_config *config);
+void sim_init(const sim_config *config);
+void sim_alternatePresets(const sim_config *config);
+void sim_setInput(uint8_t signal, bool closed);
+void sim_runUntil(uint32_t time);
+bool sim_solenoidOn();
+const char *sim_signalName(uint8_t signal);
+int sim_signalFromName(const char *name);
+bool sim_assembleProgram(const char *text, uint8_t *program);
+bool sim_isolated(void (*run)(void *arg, void *result), void *arg, void *result, size_t size);
+
+#endif /* SIM_H_ */
@@ -0,0 +1,112 @@
+/*
+This file is part of mad-phenom.
+
+mad-phenom is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+mad-phenom is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with mad-phenom.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdlib.h>
+#include "timeline.h"
+
+static uint32_t dwellOf(const sim_shot *shot) {
+	return shot->offTime > shot->onTime ? shot->offTime - shot->onTime : 0;
+}
+
+static uint32_t intervalOf(const sim_shot *shots, uint16_t i) {
+	return i > 0 ? shots[i].onTime - shots[i - 1].onTime : 0;
+}
+
+static uint32_t latencyOf(const sim_shot *shot) {
+	return shot->onTime - shot->pullTime;
+}
+
+static bool differs(uint32_t a, uint32_t b, uint32_t tolerance) {
+	return (a > b ? a - b : b - a) > tolerance;
+}
+
+void timeline_write(FILE *f, const sim_shot *shots, uint16_t count) {
+	fprintf(f, "# shot on_us dwell_us interval_us latency_us\n");
+
+	for (uint16_t i = 0; i < count; i++) {
+		fprintf(f, "%u %lu %lu %lu %lu\n", i,
+			(unsigned long)shots[i].onTime,
+			(unsigned long)dwellOf(&shots[i]),
+			(unsigned long)intervalOf(shots, i),
+			(unsigned long)latencyOf(&shots[i]));
+	}
+}
+
+int timeline_load(const char *path, sim_shot *shots, uint16_t max) {
+	FILE *f = fopen(path, "r");
+	if (!f) {
+		perror(path);
+		return -1;
+	}
+
+	char line[128];
+	unsigned index;
+	unsigned long on, dwell, interval, latency;
+	int count = 0;
+
+	while (fgets(line, sizeof(line), f) && count < max) {
+		if (sscanf(line, "%u %lu %lu %lu %lu", &index, &on, &dwell, &interval, &latency) != 5) {
+			continue;
+		}
+
+		shots[count].onTime = on;
+		shots[count].offTime = on + dwell;
+		shots[count].pullTime = on - latency;
+		count++;
+	}
+
+	fclose(f);
+	return count;
+}
+
+/************************************************************************/
+/* Reports every change in shot count, cadence, latency or dwell and    */
+/* returns the number of differences found.                             */
+/************************************************************************/
+uint16_t timeline_compare(const sim_shot *expected, uint16_t expectedCount,
+	const sim_shot *actual, uint16_t actualCount, uint32_t tolerance, FILE *report) {
+
+	uint16_t differences = 0;
+
+	if (expectedCount != actualCount) {
+		fprintf(report, "shot count: expected %u, got %u\n", expectedCount, actualCount);
+		differences++;
+	}
+
+	uint16_t count = expectedCount < actualCount ? expectedCount : actualCount;
+
+	for (uint16_t i = 0; i < count; i++) {
+		if (differs(intervalOf(expected, i), intervalOf(actual, i), tolerance)) {
+			fprintf(report, "shot %u cadence: expected %lu us, got %lu us\n", i,
+				(unsigned long)intervalOf(expected, i), (unsigned long)intervalOf(actual, i));
+			differences++;
+		}
+
+		if (differs(latencyOf(&expected[i]), latencyOf(&actual[i]), tolerance)) {
+			fprintf(report, "shot %u latency: expected %lu us, got %lu us\n", i,
+				(unsigned long)latencyOf(&expected[i]), (unsigned long)latencyOf(&actual[i]));
+			differences++;
+		}
+
+		if (differs(dwellOf(&expected[i]), dwellOf(&actual[i]), tolerance)) {
+			fprintf(report, "shot %u dwell: expected %lu us, got %lu us\n", i,
+				(unsigned long)dwellOf(&expected[i]), (unsigned long)dwellOf(&actual[i]));
+			differences++;
+		}
+	}
+
+	return differences;
+}
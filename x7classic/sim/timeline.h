@@ -0,0 +1,36 @@
+/*
+This file is part of mad-phenom.
+
+mad-phenom is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+mad-phenom is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with mad-phenom.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef TIMELINE_H_
+#define TIMELINE_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include "sim.h"
+
+/************************************************************************/
+/* Shot timelines.  One line per shot:                                  */
+/*   <shot> <on_us> <dwell_us> <interval_us> <latency_us>               */
+/* interval is measured from the previous shot, latency from the        */
+/* trigger pull that preceded the shot.                                 */
+/************************************************************************/
+
+void timeline_write(FILE *f, const sim_shot *shots, uint16_t count);
+int timeline_load(const char *path, sim_shot *shots, uint16_t max);
+uint16_t timeline_compare(const sim_shot *expected, uint16_t expectedCount,
+	const sim_shot *actual, uint16_t actualCount, uint32_t tolerance, FILE *report);
+
+#endif /* TIMELINE_H_ */
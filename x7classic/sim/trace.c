@@ -0,0 +1,239 @@
+/*
+This file is part of mad-phenom.
+
+mad-phenom is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+mad-phenom is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with mad-phenom.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "trace.h"
+#include "sim.h"
+
+#define VCD_MAX_WIRES 16
+
+void trace_init(trace *t) {
+	t->events = NULL;
+	t->count = 0;
+	t->capacity = 0;
+	t->end = 0;
+}
+
+void trace_free(trace *t) {
+	free(t->events);
+	trace_init(t);
+}
+
+void trace_add(trace *t, uint32_t time, uint8_t signal, bool closed) {
+	if (t->count == t->capacity) {
+		t->capacity = t->capacity ? t->capacity * 2 : 64;
+		t->events = realloc(t->events, t->capacity * sizeof(trace_event));
+	}
+
+	t->events[t->count].time = time;
+	t->events[t->count].signal = signal;
+	t->events[t->count].closed = closed;
+	t->count++;
+
+	if (time > t->end) {
+		t->end = time;
+	}
+}
+
+// Insertion sort keeps events with equal timestamps in the order added
+void trace_sort(trace *t) {
+	for (uint32_t i = 1; i < t->count; i++) {
+		trace_event event = t->events[i];
+		uint32_t j = i;
+
+		while (j > 0 && t->events[j - 1].time > event.time) {
+			t->events[j] = t->events[j - 1];
+			j--;
+		}
+
+		t->events[j] = event;
+	}
+}
+
+/************************************************************************/
+/* Text traces                                                          */
+/************************************************************************/
+static bool loadText(FILE *f, trace *t) {
+	char line[128];
+	char name[32];
+	unsigned long time;
+	int level;
+	uint32_t lineNumber = 0;
+
+	while (fgets(line, sizeof(line), f)) {
+		lineNumber++;
+
+		char *comment = strchr(line, '#');
+		if (comment) {
+			*comment = '\0';
+		}
+
+		if (sscanf(line, " end %lu", &time) == 1) {
+			if (time > t->end) {
+				t->end = time;
+			}
+			continue;
+		}
+
+		int fields = sscanf(line, "%lu %31s %d", &time, name, &level);
+		if (fields <= 0) {
+			continue;
+		}
+
+		int signal = sim_signalFromName(name);
+		if (fields != 3 || signal < 0) {
+			fprintf(stderr, "trace: bad event on line %lu\n", (unsigned long)lineNumber);
+			return false;
+		}
+
+		trace_add(t, time, signal, level != 0);
+	}
+
+	return true;
+}
+
+/************************************************************************/
+/* VCD traces (single bit wires only, everything else is skipped)       */
+/************************************************************************/
+static double vcdUnit(const char *unit) {
+	if (strcmp(unit, "s") == 0)  return 1e6;
+	if (strcmp(unit, "ms") == 0) return 1e3;
+	if (strcmp(unit, "us") == 0) return 1;
+	if (strcmp(unit, "ns") == 0) return 1e-3;
+	if (strcmp(unit, "ps") == 0) return 1e-6;
+	return 0;
+}
+
+static bool loadVcd(FILE *f, trace *t) {
+	char token[64];
+	char ids[VCD_MAX_WIRES][16];
+	int signals[VCD_MAX_WIRES];
+	uint8_t wires = 0;
+	double scale = 1; // us per VCD time unit
+	unsigned long long now = 0;
+
+	while (fscanf(f, "%63s", token) == 1) {
+		if (strcmp(token, "$timescale") == 0) {
+			char value[32];
+			char unit[32] = "";
+			double amount = 0;
+
+			if (fscanf(f, "%31s", value) != 1) {
+				return false;
+			}
+
+			// Both "1us" and "1 us" are legal
+			int used = 0;
+			sscanf(value, "%lf%n", &amount, &used);
+			if (value[used] != '\0') {
+				strcpy(unit, value + used);
+			} else if (fscanf(f, "%31s", unit) != 1) {
+				return false;
+			}
+
+			scale = amount * vcdUnit(unit);
+			if (scale <= 0) {
+				fprintf(stderr, "trace: unsupported timescale %s\n", unit);
+				return false;
+			}
+		} else if (strcmp(token, "$var") == 0) {
+			char type[16], id[16], name[32];
+			unsigned width;
+
+			if (fscanf(f, "%15s %u %15s %31s", type, &width, id, name) != 4) {
+				return false;
+			}
+
+			int signal = sim_signalFromName(name);
+			if (width == 1 && signal >= 0 && wires < VCD_MAX_WIRES) {
+				strcpy(ids[wires], id);
+				signals[wires] = signal;
+				wires++;
+			}
+		} else if (token[0] == '#') {
+			now = strtoull(token + 1, NULL, 10);
+		} else if (token[0] == '0' || token[0] == '1') {
+			for (uint8_t i = 0; i < wires; i++) {
+				if (strcmp(token + 1, ids[i]) == 0) {
+					// Raw pin level, the switches pull the pin low
+					trace_add(t, (uint32_t)(now * scale), signals[i], token[0] == '0');
+				}
+			}
+		}
+	}
+
+	uint32_t last = (uint32_t)(now * scale);
+	if (last > t->end) {
+		t->end = last;
+	}
+
+	return true;
+}
+
+bool trace_load(const char *path, trace *t) {
+	FILE *f = fopen(path, "r");
+	if (!f) {
+		perror(path);
+		return false;
+	}
+
+	int first;
+	while ((first = fgetc(f)) != EOF && isspace(first)) {
+	}
+	ungetc(first, f);
+
+	bool ok = (first == '$') ? loadVcd(f, t) : loadText(f, t);
+	fclose(f);
+
+	// Logic analyzer exports are not guaranteed to be time ordered
+	trace_sort(t);
+
+	return ok;
+}
+
+bool trace_save(const char *path, const trace *t) {
+	FILE *f = fopen(path, "w");
+	if (!f) {
+		perror(path);
+		return false;
+	}
+
+	fprintf(f, "# time_us signal closed\n");
+	for (uint32_t i = 0; i < t->count; i++) {
+		fprintf(f, "%lu %s %d\n", (unsigned long)t->events[i].time,
+			sim_signalName(t->events[i].signal), t->events[i].closed ? 1 : 0);
+	}
+	fprintf(f, "end %lu\n", (unsigned long)t->end);
+
+	fclose(f);
+	return true;
+}
+
+/************************************************************************/
+/* Feeds the trace through the simulator, then keeps running for tail   */
+/* us so queued shots and bursts can finish.                            */
+/************************************************************************/
+void trace_play(const trace *t, uint32_t tail) {
+	for (uint32_t i = 0; i < t->count; i++) {
+		sim_runUntil(t->events[i].time);
+		sim_setInput(t->events[i].signal, t->events[i].closed);
+	}
+
+	sim_runUntil(t->end + tail);
+}
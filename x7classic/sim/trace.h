@@ -0,0 +1,55 @@
+/*
+This file is part of mad-phenom.
+
+mad-phenom is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+mad-phenom is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with mad-phenom.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/************************************************************************/
+/* Input traces.  Two formats are read:                                 */
+/*                                                                      */
+/*   Text - one event per line, "<time_us> <signal> <1=closed|0=open>"  */
+/*          plus an optional "end <time_us>" line.  Signals are         */
+/*          trigger1, trigger2, button and selector (or PB2, PA6, PB1,  */
+/*          PB0).  '#' starts a comment.                                */
+/*   VCD  - as exported by most logic analyzers.  Wire names follow the */
+/*          same signal names and carry raw pin levels (0 = closed).    */
+/************************************************************************/
+
+typedef struct {
+	uint32_t time; // us
+	uint8_t signal;
+	bool closed;
+} trace_event;
+
+typedef struct {
+	trace_event *events;
+	uint32_t count;
+	uint32_t capacity;
+	uint32_t end; // us, the replay runs at least this long
+} trace;
+
+void trace_init(trace *t);
+void trace_free(trace *t);
+void trace_add(trace *t, uint32_t time, uint8_t signal, bool closed);
+void trace_sort(trace *t);
+bool trace_load(const char *path, trace *t);
+bool trace_save(const char *path, const trace *t);
+void trace_play(const trace *t, uint32_t tail);
+
+#endif /* TRACE_H_ */
@@ -0,0 +1,94 @@
+/*
+This file is part of mad-phenom.
+
+mad-phenom is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+mad-phenom is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with mad-phenom.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "valve.h"
+
+void valve_defaultModel(valve_model *model) {
+	model->pullIn = 4500;
+	model->cycle = 17000;
+	model->reset = 6000;
+	model->nominalVoltage = 9.0f;
+	model->minimumVoltage = 5.5f;
+}
+
+/************************************************************************/
+/* Solenoid force goes with the square of the current, so the pull-in   */
+/* time stretches with (nominal / supply)^2 as the battery sags.        */
+/************************************************************************/
+uint32_t valve_pullIn(const valve_model *model, float voltage) {
+	float ratio = model->nominalVoltage / voltage;
+
+	return (uint32_t)(model->pullIn * ratio * ratio);
+}
+
+/************************************************************************/
+/* Shortest time between two shots that still lets the mechanism reset  */
+/************************************************************************/
+uint32_t valve_minimumCycle(const valve_model *model) {
+	return model->cycle + model->reset;
+}
+
+void valve_check(const valve_model *model, float voltage, const sim_shot *shots, uint16_t count, valve_result *result) {
+	uint32_t pullIn = valve_pullIn(model, voltage);
+	uint32_t ready = 0; // us when the mechanism can take the next trip
+	bool tripped = false;
+
+	result->shots = count;
+	result->fired = 0;
+	result->weakDwell = 0;
+	result->shortCycle = 0;
+	result->noPullIn = 0;
+	result->minimumMargin = UINT32_MAX;
+	result->firstFailure = VALVE_OK;
+
+	for (uint16_t i = 0; i < count; i++) {
+		uint8_t failure = VALVE_OK;
+		uint32_t dwell = shots[i].offTime > shots[i].onTime ? shots[i].offTime - shots[i].onTime : 0;
+		uint32_t trip = shots[i].onTime + pullIn;
+
+		if (voltage < model->minimumVoltage) {
+			failure = VALVE_NO_PULL_IN;
+			result->noPullIn++;
+		} else if (dwell < pullIn) {
+			failure = VALVE_WEAK_DWELL;
+			result->weakDwell++;
+		} else if (tripped && trip < ready) {
+			failure = VALVE_SHORT_CYCLE;
+			result->shortCycle++;
+		} else {
+			if (tripped && trip - ready < result->minimumMargin) {
+				result->minimumMargin = trip - ready;
+			}
+
+			result->fired++;
+			ready = trip + model->cycle + model->reset;
+			tripped = true;
+		}
+
+		if (failure != VALVE_OK && result->firstFailure == VALVE_OK) {
+			result->firstFailure = failure;
+		}
+	}
+}
+
+const char *valve_failureName(uint8_t failure) {
+	switch (failure) {
+		case VALVE_WEAK_DWELL:  return "weak dwell";
+		case VALVE_SHORT_CYCLE: return "short cycle";
+		case VALVE_NO_PULL_IN:  return "no pull-in";
+		default:                return "ok";
+	}
+}
@@ -0,0 +1,63 @@
+/*
+This file is part of mad-phenom.
+
+mad-phenom is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+mad-phenom is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with mad-phenom.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef VALVE_H_
+#define VALVE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sim.h"
+
+/************************************************************************/
+/* Mechanical model of the X7 solenoid, sear and bolt.                  */
+/*                                                                      */
+/* PA7 high -> the solenoid needs pullIn us (scaled by supply voltage)  */
+/* to trip the sear.  If PA7 drops first the sear is not released.      */
+/* Once tripped the bolt needs cycle us to fire and come back, and the  */
+/* valve needs reset us to recharge.  A shot whose sear trip comes      */
+/* before the previous cycle has reset short-strokes the marker.        */
+/************************************************************************/
+
+typedef struct {
+	uint16_t pullIn;         // us at nominalVoltage
+	uint16_t cycle;          // us sear release to bolt back on the sear
+	uint16_t reset;          // us valve recharge after the bolt returns
+	float nominalVoltage;    // V the pull-in time was measured at
+	float minimumVoltage;    // V below which the solenoid will not pull in at all
+} valve_model;
+
+#define VALVE_OK          0
+#define VALVE_WEAK_DWELL  1 // PA7 dropped before the sear tripped
+#define VALVE_SHORT_CYCLE 2 // Tripped before the previous cycle reset
+#define VALVE_NO_PULL_IN  3 // Supply too low to pull in
+
+typedef struct {
+	uint16_t shots;
+	uint16_t fired;
+	uint16_t weakDwell;
+	uint16_t shortCycle;
+	uint16_t noPullIn;
+	uint32_t minimumMargin; // us, smallest gap between ready and the next trip
+	uint8_t firstFailure;   // VALVE_* of the first bad shot
+} valve_result;
+
+void valve_defaultModel(valve_model *model);
+uint32_t valve_pullIn(const valve_model *model, float voltage);
+uint32_t valve_minimumCycle(const valve_model *model);
+void valve_check(const valve_model *model, float voltage, const sim_shot *shots, uint16_t count, valve_result *result);
+const char *valve_failureName(uint8_t failure);
+
+#endif /* VALVE_H_ */
@@ -0,0 +1,159 @@
+/*
+This file is part of mad-phenom.
+
+mad-phenom is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+mad-phenom is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with mad-phenom.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/************************************************************************/
+/* Finds the highest safe BALLS_PER_SECOND for each battery voltage.    */
+/* Every rate from 5 to 40 is fired as a full auto string through the  */
+/* simulated firing core and the PA7 timeline is run through the valve  */
+/* model.  A rate is safe when every shot trips the sear and no shot    */
+/* arrives before the mechanism has reset.                              */
+/*                                                                      */
+/* Build from x7classic/:                                               */
+/*   gcc -std=gnu99 -O2 -Isim/host -o valvecheck sim/valvecheck.c       */
+/*       sim/valve.c sim/sim.c Program.c Common.c Globals.c Trigger.c   */
+/*       Solenoid.c PushButton.c Battery.c Trainer.c                    */
+/************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "sim.h"
+#include "valve.h"
+#include "../Globals.h"
+
+#define VALVE_STRING_US 2000000
+
+typedef struct {
+	sim_config config;
+	uint8_t dwell; // ms, 0 keeps the firmware's DWELL
+} valve_run;
+
+typedef struct {
+	uint16_t count;
+	sim_shot shots[SIM_MAX_SHOTS];
+} valve_timeline;
+
+static void runString(void *arg, void *result) {
+	const valve_run *run = arg;
+	valve_timeline *out = result;
+
+	sim_init(&run->config);
+	if (run->dwell > 0) {
+		DWELL = run->dwell;
+	}
+
+	sim_runUntil(10000);
+	sim_setInput(SIM_TRIGGER_1, true);
+	sim_runUntil(10000 + VALVE_STRING_US);
+	sim_setInput(SIM_TRIGGER_1, false);
+	sim_runUntil(sim_time + 200000);
+
+	out->count = sim_shotCount;
+	for (uint16_t i = 0; i < sim_shotCount; i++) {
+		out->shots[i] = sim_shots[i];
+	}
+}
+
+static void usage() {
+	fprintf(stderr,
+		"usage: valvecheck [options]\n"
+		"  -w ms        dwell override (default: firmware DWELL)\n"
+		"  -i us        solenoid pull-in time at the nominal voltage (default 4500)\n"
+		"  -c us        bolt cycle time (default 17000)\n"
+		"  -r us        valve reset time (default 6000)\n"
+		"  -n volts     nominal voltage for the pull-in time (default 9.0)\n"
+		"  -l volts     lowest voltage that still pulls in (default 5.5)\n"
+		"  -v           print every rate, not just the summary\n");
+	exit(2);
+}
+
+int main(int argc, char **argv) {
+	valve_model model;
+	valve_run run;
+	bool verbose = false;
+	int option;
+
+	valve_defaultModel(&model);
+	sim_defaultConfig(&run.config);
+	run.config.firingMode = 0;
+	run.dwell = 0;
+
+	while ((option = getopt(argc, argv, "w:i:c:r:n:l:v")) != -1) {
+		switch (option) {
+			case 'w': run.dwell = atoi(optarg); break;
+			case 'i': model.pullIn = atoi(optarg); break;
+			case 'c': model.cycle = atoi(optarg); break;
+			case 'r': model.reset = atoi(optarg); break;
+			case 'n': model.nominalVoltage = atof(optarg); break;
+			case 'l': model.minimumVoltage = atof(optarg); break;
+			case 'v': verbose = true; break;
+			default: usage();
+		}
+	}
+
+	// The timelines do not depend on the voltage, run each rate once
+	static valve_timeline timelines[36];
+	for (uint8_t bps = 5; bps <= 40; bps++) {
+		run.config.ballsPerSecond = bps;
+
+		if (!sim_isolated(runString, &run, &timelines[bps - 5], sizeof(valve_timeline))) {
+			fprintf(stderr, "valvecheck: run failed\n");
+			return 1;
+		}
+	}
+
+	printf("# pull-in %u us @ %.1f V, cycle %u us, reset %u us\n",
+		model.pullIn, model.nominalVoltage, model.cycle, model.reset);
+	printf("volts pullin_us mininterval_us  max_bps  first_bad  reason\n");
+
+	for (float voltage = 6.0f; voltage <= 9.61f; voltage += 0.2f) {
+		uint8_t safe = 0;
+		uint8_t firstBad = 0;
+		uint8_t reason = VALVE_OK;
+
+		for (uint8_t bps = 5; bps <= 40; bps++) {
+			valve_result result;
+			const valve_timeline *timeline = &timelines[bps - 5];
+
+			valve_check(&model, voltage, timeline->shots, timeline->count, &result);
+
+			if (verbose) {
+				printf("  %.1f V %2u bps: %u/%u fired, %u weak, %u short, margin %ld us\n",
+					voltage, bps, result.fired, result.shots, result.weakDwell, result.shortCycle,
+					result.minimumMargin == UINT32_MAX ? -1L : (long)result.minimumMargin);
+			}
+
+			if (result.firstFailure == VALVE_OK) {
+				if (firstBad == 0) {
+					safe = bps;
+				}
+			} else if (firstBad == 0) {
+				firstBad = bps;
+				reason = result.firstFailure;
+			}
+		}
+
+		char firstBadText[8] = "-";
+		if (firstBad) {
+			snprintf(firstBadText, sizeof(firstBadText), "%u", firstBad);
+		}
+
+		printf("%5.1f %9lu %14lu %8u %10s  %s\n", voltage,
+			(unsigned long)valve_pullIn(&model, voltage), (unsigned long)valve_minimumCycle(&model),
+			safe, firstBadText, valve_failureName(reason));
+	}
+
+	return 0;
+}
@@ -0,0 +1,164 @@
+#!/usr/bin/env python
+#
+# This file is part of mad-phenom.
+#
+# mad-phenom is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# mad-phenom is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with mad-phenom.  If not, see <http://www.gnu.org/licenses/>.
+#
+# Field uploader for the bootloader (Bootloader.h).
+#
+# Reads the Intel HEX that Atmel Studio builds, keeps everything below
+# the bootloader and sends it page by page over the push button line:
+# active low 8N1 at 4800 baud, one way.  Page 0 is the bootloader's own
+# vector table and is never sent, the application starts at page 1.  Wire a USB serial adapter's TX
+# to the button pin through a diode (cathode towards TX) and ground to
+# ground.  Power the marker on with the button and trigger held, let go
+# of the button, then run this.  The red LED stays on while it listens,
+# the green one changes per page, a red blink means start again.
+#
+# There is no reply channel, so the uploader paces itself: each frame is
+# followed by a gap long enough for the page erase and write.
+#
+# usage: fwupload.py [options] image.hex
+#   -p PORT     send to this serial port (needs pyserial)
+#   --trace F   write the line as a simulator trace instead (sim/bootload)
+#   --bin F     write the padded image as the bootloader will leave it
+
+import argparse
+import sys
+import time
+
+BOOTLOADER_START = 0x0E00
+APP_ENTRY = 0x0DFE  # rjmp into the application, its page is sent last
+APP_VECTORS = 0x0040
+VECTORS_SIZE = 34
+PAGE_SIZE = 64
+BAUD = 4800
+FRAME_GAP = 0.020  # s, page erase and write take 9ms
+FRAME_PAGE = 0xA5
+
+def read_hex(path):
+    image = bytearray(b'\xff' * BOOTLOADER_START)
+    base = 0
+    bootloader = 0
+    with open(path) as f:
+        for number, line in enumerate(f, 1):
+            line = line.strip()
+            if not line:
+                continue
+            if not line.startswith(':'):
+                sys.exit('%s:%d: not Intel HEX' % (path, number))
+            record = bytes.fromhex(line[1:])
+            if sum(record) & 0xFF:
+                sys.exit('%s:%d: checksum error' % (path, number))
+            length, address, kind, data = record[0], (record[1] << 8) | record[2], record[3], record[4:-1]
+            if kind == 0:
+                for i, byte in enumerate(data):
+                    where = base + address + i
+                    if where < BOOTLOADER_START:
+                        image[where] = byte
+                    else:
+                        bootloader += 1
+            elif kind == 1:
+                break
+            elif kind == 2:
+                base = ((data[0] << 8) | data[1]) << 4
+            elif kind == 4:
+                base = ((data[0] << 8) | data[1]) << 16
+    if not bootloader:
+        print('no bootloader section, check the image was linked for 0x%04x' % BOOTLOADER_START)
+    if image[APP_ENTRY + 1] & 0xF0 != 0xC0:
+        print('0x%04x does not hold the rjmp into the application, check the link flags' % APP_ENTRY)
+    if image[:PAGE_SIZE] != vector_page():
+        sys.exit('%s: page 0 is not the bootloader\'s vector table, link the application at 0x%04x' %
+                 (path, APP_VECTORS))
+    return image
+
+def rjmp(source, target):
+    return 0xC000 | (((target - source) // 2 - 1) & 0x0FFF)
+
+def vector_page():
+    # As bootloader_vectors: reset to the bootloader, the rest on to the application
+    page = bytearray(b'\xff' * PAGE_SIZE)
+    for i in range(0, VECTORS_SIZE, 2):
+        word = rjmp(i, BOOTLOADER_START if i == 0 else APP_VECTORS + i)
+        page[i:i + 2] = bytes([word & 0xFF, word >> 8])
+    return page
+
+def crc16(data, crc=0xFFFF):
+    # CRC16-CCITT, polynomial 0x1021, MSB first, as the bootloader
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+def frames(image):
+    # Page 1 up to the entry page, CRC16 (BE) over the whole frame before it
+    for index in range(1, BOOTLOADER_START // PAGE_SIZE):
+        frame = bytes([FRAME_PAGE, index]) + image[index * PAGE_SIZE:(index + 1) * PAGE_SIZE]
+        crc = crc16(frame)
+        yield frame + bytes([crc >> 8, crc & 0xFF])
+
+def write_trace(path, image):
+    bit = 1000000.0 / BAUD
+    now = 0.0
+    low = False
+    with open(path, 'w') as f:
+        f.write('# fwupload.py, push button line at %d baud\n' % BAUD)
+        for frame in frames(image):
+            for byte in frame:
+                bits = [0] + [(byte >> i) & 1 for i in range(8)] + [1]
+                for level in bits:
+                    if (level == 0) != low:
+                        low = level == 0
+                        f.write('%d button %d\n' % (round(now), 1 if low else 0))
+                    now += bit
+            now += FRAME_GAP * 1000000
+        f.write('end %d\n' % round(now))
+
+def send(port, image):
+    import serial
+    line = serial.Serial(port, BAUD, bytesize=8, parity='N', stopbits=1)
+    total = BOOTLOADER_START // PAGE_SIZE - 1
+    for number, frame in enumerate(frames(image)):
+        line.write(frame)
+        line.flush()
+        time.sleep(FRAME_GAP)
+        sys.stdout.write('\rpage %d of %d' % (number + 1, total))
+        sys.stdout.flush()
+    line.close()
+    print('\ndone, the marker starts the new image')
+
+def main():
+    parser = argparse.ArgumentParser(description='Upload firmware through the bootloader.')
+    parser.add_argument('hex')
+    parser.add_argument('-p', '--port')
+    parser.add_argument('--trace')
+    parser.add_argument('--bin')
+    args = parser.parse_args()
+    if not (args.port or args.trace or args.bin):
+        parser.error('one of -p, --trace or --bin is needed')
+
+    image = read_hex(args.hex)
+    if args.bin:
+        with open(args.bin, 'wb') as f:
+            f.write(image)
+    if args.trace:
+        write_trace(args.trace, image)
+    if args.port:
+        send(args.port, image)
+
+if __name__ == '__main__':
+    main()
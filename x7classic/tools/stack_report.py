@@ -0,0 +1,131 @@
+#!/usr/bin/env python
+#
+# This file is part of mad-phenom.
+#
+# mad-phenom is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# mad-phenom is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with mad-phenom.  If not, see <http://www.gnu.org/licenses/>.
+#
+# Static stack and RAM budget for the firmware.
+#
+# The project compiles with -fstack-usage, so every object leaves a .su
+# file with the frame size of each function (pushed registers and the
+# return address included).  The call graph comes from the disassembly
+# of the .elf.  Functions without a .su entry (avr-libc) are estimated
+# from their push instructions.
+#
+# usage: stack_report.py <build dir> [elf]
+#   e.g. stack_report.py Debug Debug/x7classic.elf
+
+import os
+import re
+import subprocess
+import sys
+
+SRAM_SIZE = 256
+ISR_ENTRY = 2  # return address pushed by the interrupt itself
+
+def load_frames(build_dir):
+    frames = {}
+    for root, _, files in os.walk(build_dir):
+        for name in files:
+            if not name.endswith('.su'):
+                continue
+            with open(os.path.join(root, name)) as f:
+                for line in f:
+                    location, size, _ = line.rstrip('\n').split('\t')
+                    frames[location.split(':')[-1]] = int(size)
+    return frames
+
+def load_calls(elf):
+    calls = {}
+    pushes = {}
+    indirect = set()
+    current = None
+    disassembly = subprocess.check_output(['avr-objdump', '-d', elf]).decode()
+    for line in disassembly.splitlines():
+        label = re.match(r'^[0-9a-f]+ <([^>]+)>:', line)
+        if label:
+            current = label.group(1)
+            calls.setdefault(current, set())
+            pushes[current] = 0
+            continue
+        if current is None:
+            continue
+        # 'rcall .+0' only reserves two bytes of frame, already in the .su size
+        if re.search(r'\srcall\s+\.\+0\b', line):
+            continue
+        call = re.search(r'\s(r?call)\s.*<([^>+]+)', line)
+        if call:
+            calls[current].add(call.group(2))
+        elif re.search(r'\s(e?icall)\b', line):
+            indirect.add(current)
+        elif re.search(r'\spush\s', line):
+            pushes[current] += 1
+    return calls, pushes, indirect
+
+def ram_sections(elf):
+    sizes = {'.data': 0, '.bss': 0, '.noinit': 0}
+    output = subprocess.check_output(['avr-size', '-A', elf]).decode()
+    for line in output.splitlines():
+        fields = line.split()
+        if len(fields) >= 2 and fields[0] in sizes:
+            sizes[fields[0]] = int(fields[1])
+    return sizes
+
+def main():
+    if len(sys.argv) < 2:
+        sys.exit('usage: stack_report.py <build dir> [elf]')
+    build_dir = sys.argv[1]
+    elf = sys.argv[2] if len(sys.argv) > 2 else os.path.join(build_dir, 'x7classic.elf')
+
+    frames = load_frames(build_dir)
+    calls, pushes, indirect = load_calls(elf)
+
+    def frame(name):
+        if name in frames:
+            return frames[name]
+        return pushes.get(name, 0) + 2
+
+    depth = {}
+    def worst(name, path):
+        if name in path:
+            raise SystemExit('recursion: ' + ' -> '.join(path + [name]))
+        if name not in depth:
+            below = [worst(callee, path + [name]) for callee in calls.get(name, ())]
+            depth[name] = frame(name) + max([0] + below)
+        return depth[name]
+
+    print('%-28s %6s %6s' % ('function', 'frame', 'worst'))
+    for name in sorted(calls, key=lambda n: -worst(n, [])):
+        if name in frames or calls[name]:
+            print('%-28s %6d %6d%s' % (name, frame(name), worst(name, []),
+                                         '  (indirect calls not counted)' if name in indirect else ''))
+
+    vectors = [name for name in calls if name.startswith('__vector_')]
+    main_depth = worst('main', []) if 'main' in calls else 0
+    isr_depth = max([worst(v, []) + ISR_ENTRY for v in vectors] + [0])
+    ram = ram_sections(elf)
+    static_ram = sum(ram.values())
+    budget = static_ram + main_depth + isr_depth
+
+    print('')
+    print('static RAM   .data %d  .bss %d  .noinit %d  = %d bytes' %
+          (ram['.data'], ram['.bss'], ram['.noinit'], static_ram))
+    print('stack        main %d + deepest ISR %d = %d bytes' % (main_depth, isr_depth, main_depth + isr_depth))
+    print('total        %d of %d bytes, %d bytes headroom' % (budget, SRAM_SIZE, SRAM_SIZE - budget))
+
+    if budget > SRAM_SIZE:
+        sys.exit(1)
+
+if __name__ == '__main__':
+    main()